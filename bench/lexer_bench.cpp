@@ -0,0 +1,79 @@
+#include "Diagnostics.h"
+#include "Lexer.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Measures Lexer::scan_tokens throughput on generated corpora. Each corpus is
+// scanned several times and the fastest run is reported, which filters out
+// warm-up and scheduling noise.
+
+namespace {
+
+constexpr int runs = 5;
+constexpr int corpus_repeats = 100000;
+
+struct Corpus {
+    std::string name;
+    std::string source;
+};
+
+auto repeat(const std::string &chunk) -> std::string {
+    std::string source;
+    source.reserve(chunk.size() * corpus_repeats);
+    for (int i = 0; i < corpus_repeats; i++) {
+        source += chunk;
+    }
+    return source;
+}
+
+auto corpora() -> std::vector<Corpus> {
+    return {
+        {"ascii-code",
+         repeat("var foo = (bar + 12.5) * baz_qux / 3; // comment here\n"
+                "if (a <= b and c != d) { count = count - 1; }\n"
+                "/* block */ while (!done) { x = x >= y == true; }\n")},
+        {"ascii-strings",
+         repeat("print \"The quick brown fox jumps over the lazy dog, then "
+                "naps in the warm afternoon sun for a while.\";\n")},
+        {"mixed-utf8",
+         repeat("var größe = (höhe + 12.5) * breite; // Maße in Metern\n"
+                "var 名前 = \"こんにちは、世界\"; var café = naïve_1 - 3;\n"
+                "/* коммент */ while (!fertig) { zähler = zähler - 1; }\n")},
+    };
+}
+
+auto bench(const Corpus &corpus) -> void {
+    double best = 0;
+    std::size_t token_count = 0;
+    for (int i = 0; i < runs; i++) {
+        std::stringstream errors;
+        Diagnostics diagnostics(errors);
+        auto started = std::chrono::steady_clock::now();
+        std::vector<Token> tokens =
+            Lexer(corpus.source, diagnostics).scan_tokens();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - started;
+        best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+        token_count = tokens.size();
+    }
+
+    double megabytes = static_cast<double>(corpus.source.size()) / 1e6;
+    std::cout << std::left << std::setw(16) << corpus.name << std::right
+              << std::fixed << std::setprecision(1) << std::setw(8)
+              << megabytes << " MB" << std::setw(10) << token_count
+              << " tokens" << std::setw(9) << megabytes / best << " MB/s\n";
+}
+
+} // namespace
+
+auto main() -> int {
+    for (const Corpus &corpus : corpora()) {
+        bench(corpus);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ErrorReporter.h"
+#include "Token.h"
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+// Errors found while running one script. Every run owns its own instance and
+// hands it to its Lexer and Parser, so concurrent runs never see each other's
+// failures.
+class Diagnostics {
+  public:
+    // Reports to a standard stream are serialized with every other run's;
+    // any other stream is taken to belong to this run and is written unlocked
+    explicit Diagnostics(std::ostream &out = std::cout)
+        : out(out), out_mutex(ErrorReporter::get_instance().mutex_for(out)) {}
+    // For a stream several runs share, guarded by the caller's mutex
+    Diagnostics(std::ostream &out, std::mutex &out_mutex)
+        : out(out), out_mutex(&out_mutex) {}
+
+    auto report_lexer_error(const int line, const int column,
+                            const std::string &msg) -> void {
+        std::stringstream report;
+        report << "Syntax Error [Line " << line << ", Column " << column
+               << "]: " << msg << "\n";
+        emit(report.str());
+    }
+
+    auto report_parser_error(const Token &token, const std::string &msg)
+        -> void {
+        std::string where;
+        if (token.type == TokenType::EoF) {
+            where = " at end";
+        } else {
+            where = " at ";
+        }
+        std::stringstream report;
+        report << "[line " << token.line_num << "] Error" << where << ": "
+               << msg << "\n";
+        emit(report.str());
+    }
+
+    auto has_error() const -> bool { return error_count > 0; }
+    auto count() const -> int { return error_count; }
+
+  private:
+    std::ostream &out;
+    std::mutex *out_mutex;
+    int error_count = 0;
+
+    // Each report is written whole, so lines on a shared stream never
+    // interleave
+    auto emit(const std::string &report) -> void {
+        error_count++;
+        if (out_mutex == nullptr) {
+            out << report;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(*out_mutex);
+        out << report;
+    }
+};
@@ -1,13 +1,15 @@
 #pragma once
 
-#include "Token.h"
 #include <iostream>
-#include <string>
+#include <mutex>
+#include <ostream>
 
+// Owns the lock for the process-wide standard streams, so diagnostics from
+// concurrent runs never interleave there. A stream only one run writes to
+// needs no lock, and whether a particular run failed is tracked by that run's
+// Diagnostics.
 class ErrorReporter {
   public:
-    bool has_error = false;
-
     // Delete copy and assign operator to enforce singleton
     ErrorReporter(const ErrorReporter &) = delete;
     ErrorReporter &operator=(const ErrorReporter &) = delete;
@@ -17,21 +19,17 @@ class ErrorReporter {
         return instance;
     }
 
-    auto report_lexer_error(const int line, const std::string &msg) {
-        std::cout << "Syntax Error [Line " << line << "]: " << msg << "\n";
-    }
-
-    auto report_parser_error(const Token token, const std::string &msg) {
-        std::string where;
-        if (token.type == TokenType::EoF) {
-            where = " at end";
-        } else {
-            where = " at ";
+    // The mutex to hold while writing to out, or nullptr if out is not one
+    // of the standard streams
+    auto mutex_for(const std::ostream &out) -> std::mutex * {
+        if (&out == &std::cout || &out == &std::cerr || &out == &std::clog) {
+            return &output_mutex;
         }
-        std::cout << "[line " << token.line_num << "] Error" << where << ": "
-                  << msg << "\n";
+        return nullptr;
     }
 
   private:
+    std::mutex output_mutex;
+
     ErrorReporter() {}
 };
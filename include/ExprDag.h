@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Token.h"
+#include <cstddef>
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+// Hash-consed form of parsed expressions. Structurally identical
+// subexpressions are stored once and referred to by id, so the tree becomes a
+// DAG. Every expression in the grammar is pure, so sharing never changes
+// meaning, and an evaluator can cache results per id to compute each shared
+// subexpression once. The parser builds it directly (Parser::parse_input with
+// a dag), so duplicates are never allocated as tree nodes. Groupings and
+// operator-less Unary wrappers carry no meaning of their own and get no node.
+class ExprDag {
+  public:
+    using NodeId = int;
+
+    enum class Kind { Literal, Unary, Binary };
+
+    struct Node {
+        Kind kind;
+        // The literal's value, or the operator for Unary and Binary
+        Token token;
+        NodeId left = -1; // Operand of Unary, left operand of Binary
+        NodeId right = -1;
+    };
+
+    ExprDag() = default;
+    // The id set's hash and equality point back at this object's nodes
+    ExprDag(const ExprDag &) = delete;
+    auto operator=(const ExprDag &) -> ExprDag & = delete;
+
+    // Each returns the id of the matching node, adding it only if no
+    // identical node is stored yet
+    auto literal(const Token &value) -> NodeId;
+    auto unary(const Token &op, NodeId operand) -> NodeId;
+    auto binary(NodeId left, const Token &op, NodeId right) -> NodeId;
+
+    auto node(NodeId id) const -> const Node & { return nodes.at(id); }
+    // Distinct nodes stored
+    auto size() const -> std::size_t { return nodes.size(); }
+    // Literal, Unary and Binary nodes the parsed trees had in total,
+    // before sharing
+    auto tree_size() const -> std::size_t { return interned_nodes; }
+    // Lists every node on its own line, children referring to earlier ids,
+    // e.g. "#2 = (+ #0 #1)"
+    auto print(std::ostream &out) const -> void;
+
+  private:
+    struct NodeHash {
+        const std::vector<Node> *nodes;
+        auto operator()(NodeId id) const -> std::size_t;
+    };
+
+    struct NodeEqual {
+        const std::vector<Node> *nodes;
+        auto operator()(NodeId a, NodeId b) const -> bool;
+    };
+
+    std::vector<Node> nodes;
+    // Ids of the stored nodes, hashed and compared by the node's contents,
+    // so each lexeme is kept once, in its node
+    std::unordered_set<NodeId, NodeHash, NodeEqual> ids{
+        0, NodeHash{&nodes}, NodeEqual{&nodes}};
+    std::size_t interned_nodes = 0;
+
+    auto intern(Node candidate) -> NodeId;
+};
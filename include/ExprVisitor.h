@@ -2,37 +2,37 @@
 
 #include "Expr.h"
 #include <memory>
-#include <sstream>
+#include <initializer_list>
+#include <string>
+#include <variant>
+#include <vector>
 using std::unique_ptr;
 
 // ExprVisitor is templated as all visitors don't neccesarily return the same
 // type Each concrete visitor will provide a type that they return
 template <typename T> class ExprVisitor {
-    virtual auto operator()(unique_ptr<Binary> &) -> T = 0;
-    virtual auto operator()(unique_ptr<Grouping> &) -> T = 0;
-    virtual auto operator()(unique_ptr<Literal> &) -> T = 0;
-    virtual auto operator()(unique_ptr<Unary> &) -> T = 0;
+    virtual auto operator()(const unique_ptr<Binary> &) -> T = 0;
+    virtual auto operator()(const unique_ptr<Unary> &) -> T = 0;
+    virtual auto operator()(const unique_ptr<Primary> &) -> T = 0;
 };
 
-class AstPrinter : ExprVisitor<std::string> {
+// Prints an expression in prefix form, e.g. (* (- 1) (group (+ 2 3))).
+// Visiting a node schedules its pieces on a work stack instead of printing
+// its children recursively, so arbitrarily deep trees print fine.
+class AstPrinter : ExprVisitor<void> {
   public:
-    auto print(Expr &expr) -> std::string;
-    auto operator()(unique_ptr<Binary> &) -> std::string override;
-    auto operator()(unique_ptr<Grouping> &) -> std::string override;
-    auto operator()(unique_ptr<Literal> &) -> std::string override;
-    auto operator()(unique_ptr<Unary> &) -> std::string override;
+    auto print(const Expr &expr) -> std::string;
+    auto operator()(const unique_ptr<Binary> &) -> void override;
+    auto operator()(const unique_ptr<Unary> &) -> void override;
+    auto operator()(const unique_ptr<Primary> &) -> void override;
 
   private:
-    template <typename... Args>
-    auto parenthesize(const std::string &name, Args &...expressions)
-        -> std::string {
-        std::stringstream builder;
-        builder << "(" << name;
-        auto loop = [this, &builder](auto &arg) {
-            builder << " " << this->print(arg);
-        };
-        (loop(expressions), ...);
-        builder << ")";
-        return builder.str();
-    }
+    // Either text to emit as is, or a node still to be printed
+    using Work = std::variant<std::string, const Expr *,
+                              const unique_ptr<Unary> *,
+                              const unique_ptr<Primary> *>;
+    std::vector<Work> pending;
+
+    // Schedules the items in reading order
+    auto schedule(std::initializer_list<Work> items) -> void;
 };
@@ -1,24 +1,35 @@
 #pragma once
 
+#include "Diagnostics.h"
 #include "Token.h"
+#include <functional>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
 class Lexer {
   public:
-    Lexer(std::string source);
+    Lexer(std::string source, Diagnostics &diagnostics);
     auto scan_tokens() -> std::vector<Token>;
+    // Scans just far enough to produce one more token. The final token is
+    // EoF; after that it returns nullopt.
+    auto next_token() -> std::optional<Token>;
 
   private:
     const std::string source;
-    static std::map<std::string, TokenType> string_to_ttype;
+    Diagnostics &diagnostics;
+    static std::map<std::string, TokenType, std::less<>> string_to_ttype;
+    // Everything scanned so far for scan_tokens; when streaming, just the
+    // token next_token is about to hand out
     std::vector<Token> tokens;
+    bool emitted_eof = false;
     int start = 0;
     int current = 0;
     int line = 1;
+    int line_start = 0; // Offset of the first byte of the current line
 
-    static auto syntax_error(const int line, const std::string &msg) -> void;
+    auto syntax_error(const int position, const std::string &msg) -> void;
 
     auto is_at_end() -> bool;
     auto scan_token() -> void;
@@ -27,15 +38,16 @@ class Lexer {
     auto match(const char &expected) -> bool;
     auto peek(int amount_to_peek = 0) -> char;
 
-    auto optional_two_char(const char &optional, TokenType single_type,
-                           TokenType duo_type) -> void;
-
     auto handle_comment() -> void;
     auto handle_comment_block() -> void;
     auto handle_string() -> void;
     auto handle_number() -> void;
     auto handle_identifier() -> void;
+    auto handle_non_ascii() -> void;
+    auto skip_string_run() -> void;
+    auto skip_invalid_utf8() -> void;
 
     static auto is_digit(char c) -> bool;
     static auto is_alpha(char c) -> bool;
+    static auto is_ascii(char c) -> bool;
 };
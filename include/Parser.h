@@ -1,30 +1,64 @@
 #pragma once
 
+#include "Diagnostics.h"
 #include "Expr.h"
+#include "ExprDag.h"
+#include "Lexer.h"
 #include "Token.h"
+#include <array>
 #include <exception>
+#include <functional>
 #include <initializer_list>
 #include <optional>
 #include <vector>
 
 class Parser {
   public:
+    // Parses one expression, then pulls the rest of the input through so any
+    // lexer errors after it are still reported
     auto parse_input() -> std::optional<Expr>;
-    Parser(const std::vector<Token> &tokens) : tokens(tokens) {}
+    // Parses straight into dag, sharing nodes with everything already in it,
+    // and returns the root's id. No Expr tree is built.
+    auto parse_input(ExprDag &dag) -> std::optional<ExprDag::NodeId>;
+    // Parses an already scanned token vector
+    Parser(std::vector<Token> tokens, Diagnostics &diagnostics);
+    // Pulls tokens from the lexer as they are needed, so only a few tokens
+    // are alive at once and parsing starts before the input is fully lexed
+    Parser(Lexer &lexer, Diagnostics &diagnostics);
 
   private:
     class ParseError : public std::exception {};
 
-    std::vector<Token> tokens;
-    int current = 0;
+    // An operator waiting on the parser's stack for its operands
+    struct Frame {
+        enum class Kind { Prefix, Group, Infix };
+        Kind kind;
+        Token op;
+    };
 
-    auto parse_expression() -> Expr;
-    auto parse_equality() -> Expr;
-    auto parse_comparison() -> Expr;
-    auto parse_term() -> Expr;
-    auto parse_factor() -> Expr;
-    auto parse_unary() -> Expr;
-    auto parse_primary() -> Expr;
+    // Ring buffer holding the previous token and the current one; the
+    // grammar needs no further lookahead, and older tokens are dropped
+    static constexpr int window_size = 2;
+    std::function<std::optional<Token>()> next_token;
+    Diagnostics &diagnostics;
+    std::array<std::optional<Token>, window_size> window;
+    int current = 0; // Index of the current token in the whole stream
+    int filled = 0;  // Number of tokens pulled into the window so far
+    bool source_exhausted = false;
+
+    // Builder assembles the result, either as an Expr tree or as DAG ids;
+    // see Parser.cpp
+    template <typename Builder>
+    auto parse_expression(Builder &builder) -> typename Builder::Operand;
+    template <typename Builder>
+    static auto close_primary(typename Builder::Operand primary,
+                              std::vector<Frame> &frames, Builder &builder)
+        -> typename Builder::Operand;
+    template <typename Builder>
+    static auto reduce_infix(std::vector<typename Builder::Operand> &operands,
+                             std::vector<Frame> &frames, int min_precedence,
+                             Builder &builder) -> void;
+    static auto infix_precedence(TokenType type) -> int;
 
     // Util
     auto match(std::initializer_list<TokenType> types) -> bool;
@@ -33,6 +67,8 @@ class Parser {
     auto advance() -> Token;
     auto is_at_end() -> bool;
     auto previous() -> Token;
+    auto fill_window() -> void;
+    auto drain_input() -> void;
 
     // Error Handling
     auto consume(TokenType type, const std::string &msg) -> Token;
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <csignal>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Statistical profiler driven by a SIGPROF interval timer. Instrumented code
+// keeps a shadow stack of named frames, each tagged with the source line it is
+// working on; the signal handler copies that stack into a preallocated sample
+// buffer, so no allocation or locking happens inside the handler. Each thread
+// has its own shadow stack, so server workers can run instrumented code side
+// by side; samples are only collected for single-threaded runs.
+class Profiler {
+  public:
+    static constexpr int max_depth = 32;
+    // Frames the sample buffer reserves per sample; deeper samples draw on
+    // the slack left by shallower ones
+    static constexpr int reserved_depth = 4;
+
+    struct Frame {
+        const char *name;
+        int line;
+    };
+
+    // Pushes a frame for the lifetime of the enclosing scope
+    class Scope {
+      public:
+        Scope(const char *name, int line);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+    };
+
+    // Delete copy and assign operator to enforce singleton
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    static auto get_instance() -> Profiler &;
+
+    // The buffer holds expected_seconds worth of samples; anything past that
+    // is counted as dropped. Throws if either argument isn't positive or the
+    // timer can't be set up.
+    auto start(int interval_us = 1000, int expected_seconds = 30) -> void;
+    auto stop() -> void;
+
+    // Clears previous samples and reserves room for max_samples more
+    auto reset(std::size_t max_samples) -> void;
+    // Copies the current shadow stack into the buffer; this is what the timer
+    // signal runs, and it can be called directly to sample at a known point
+    auto record_sample() -> void;
+
+    // Updates the line of the innermost frame; a plain store so it is cheap
+    // enough to call once per token
+    auto set_line(int line) -> void {
+        if (depth > 0 && depth <= max_depth) {
+            stack[depth - 1].line = line;
+        }
+    }
+
+    // Collapsed-stack format, one "jlox;frame;...;line N count" entry per
+    // distinct stack. The innermost frame's line is a leaf of its own, so each
+    // named frame still aggregates across lines in a flame graph.
+    auto write_folded(std::ostream &os) const -> void;
+    auto print_line_summary(std::ostream &os) const -> void;
+
+  private:
+    // A sample's frame names live in frame_names[first, first + depth)
+    struct Sample {
+        int first;
+        int depth;
+        int line;
+    };
+
+    static thread_local std::array<Frame, max_depth> stack;
+    static thread_local volatile std::sig_atomic_t depth;
+    std::vector<Sample> samples;
+    std::vector<const char *> frame_names;
+    volatile std::sig_atomic_t sample_count = 0;
+    volatile std::sig_atomic_t frame_count = 0;
+    volatile std::sig_atomic_t dropped = 0;
+    bool running = false;
+
+    Profiler() {}
+
+    auto push(const char *name, int line) -> void;
+    auto pop() -> void;
+    static auto on_signal(int signal) -> void;
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <stop_token>
+#include <string>
+#include <thread>
+
+// Runs one script, writing its output, diagnostics included, to the given
+// stream, and returns whether it succeeded. Called from several worker
+// threads at once, so it must not share mutable state between runs.
+using ScriptRunner =
+    std::function<bool(const std::string &source, std::ostream &out)>;
+
+// Wire format, in both directions over a SOCK_STREAM Unix socket:
+//   request:  u32 length (network order), then that many bytes of source
+//   response: u8 status (0 ok, 1 error), u32 length, then the output bytes
+// Each connection carries one request; the server closes it after replying.
+constexpr std::uint32_t max_message_size = 64 * 1024 * 1024;
+
+enum class Status : std::uint8_t { Ok = 0, Error = 1 };
+
+struct Response {
+    Status status;
+    std::string output;
+};
+
+struct ServeOptions {
+    // Threads running scripts. Requests are read in full before a worker
+    // takes them, so slow clients never hold one.
+    unsigned worker_count = std::max(1U, std::thread::hardware_concurrency());
+    // A client that sends or accepts nothing for this long is dropped
+    std::chrono::milliseconds io_timeout{2000};
+    // Connections whose request is still arriving. Past this, new clients
+    // wait in the listen backlog until one completes or is dropped.
+    std::size_t max_pending = 1024;
+    // Request bytes buffered across all those connections. The connection
+    // whose data would pass it is dropped.
+    std::size_t max_buffered_bytes = 4 * std::size_t{max_message_size};
+    // serve returns, removing its socket, once a stop is requested
+    std::stop_token stop;
+};
+
+// Keeps one warm jlox process listening on socket_path. Every script runs in
+// a fresh session on a worker thread: new Lexer/Parser state, its own
+// Diagnostics and its own output. A stale socket at socket_path is replaced,
+// but any other file there, or a socket a live server still answers on, is
+// an error.
+auto serve(const std::filesystem::path &socket_path,
+           const ScriptRunner &run_script, const ServeOptions &options = {})
+    -> void;
+
+// Length-prefixed framing shared by server and client. read_payload returns
+// nullopt if the peer hangs up or announces more than max_message_size bytes.
+auto read_payload(int fd) -> std::optional<std::string>;
+auto write_payload(int fd, const std::string &payload) -> bool;
+
+// Sends one script to a running server; nullopt if the server hung up before
+// answering
+auto send_request(const std::filesystem::path &socket_path,
+                  const std::string &source) -> std::optional<Response>;
+
+// Sends the script to a running server, prints its output and reports the
+// round-trip latency on stderr. Returns the exit code the script should have.
+auto run_client(const std::filesystem::path &socket_path,
+                const std::filesystem::path &script_path) -> int;
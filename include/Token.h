@@ -1,6 +1,7 @@
 #pragma once
 #include <iostream>
 #include <string>
+#include <utility>
 
 enum class TokenType {
     // Single-character tokens.
@@ -59,8 +60,8 @@ struct Token {
     std::string lexeme;
     int line_num;
 
-    Token(const TokenType &type, const std::string &lexeme, const int line_num)
-        : type(type), lexeme(lexeme), line_num(line_num) {}
+    Token(const TokenType &type, std::string lexeme, const int line_num)
+        : type(type), lexeme(std::move(lexeme)), line_num(line_num) {}
 
     static auto create_eof() -> Token { return Token{TokenType::EoF, "", 0}; }
 
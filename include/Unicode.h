@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+struct CodePointRange {
+    char32_t first;
+    char32_t last;
+};
+
+// A code point decoded from UTF-8, with the number of bytes it occupied.
+// A length of 0 means the bytes at that position aren't valid UTF-8.
+struct DecodedCodePoint {
+    char32_t code_point;
+    int length;
+};
+
+// Rejects overlong encodings, surrogates and values past U+10FFFF. Stops at
+// the first byte that isn't a continuation byte, so it never reads past the
+// '\0' std::string keeps after its last character.
+auto decode_utf8(const std::string &text, int position) -> DecodedCodePoint;
+
+auto is_xid_start(char32_t code_point) -> bool;
+auto is_xid_continue(char32_t code_point) -> bool;
+
+// Number of code points starting in text[from, to)
+auto count_code_points(const std::string &text, int from, int to) -> int;
@@ -1,21 +1,48 @@
-/*#include "ExprVisitor.h"*/
-/**/
-/*auto AstPrinter::print(Expr &expr) -> std::string {*/
-/*    return std::visit(*this, expr);*/
-/*}*/
-/**/
-/*auto AstPrinter::operator()(unique_ptr<Binary> &expr) -> std::string {*/
-/*    return parenthesize(expr->op.lexeme, expr->left, expr->right);*/
-/*}*/
-/**/
-/*auto AstPrinter::operator()(unique_ptr<Grouping> &expr) -> std::string {*/
-/*    return parenthesize("group", expr->expr);*/
-/*}*/
-/**/
-/*auto AstPrinter::operator()(unique_ptr<Literal> &expr) -> std::string {*/
-/*    return expr->val.lexeme;*/
-/*}*/
-/**/
-/*auto AstPrinter::operator()(unique_ptr<Unary> &expr) -> std::string {*/
-/*    return parenthesize(expr->op.lexeme, expr->expr);*/
-/*}*/
+#include "ExprVisitor.h"
+#include <iterator>
+
+auto AstPrinter::print(const Expr &expr) -> std::string {
+    std::string out;
+    pending.clear();
+    pending.emplace_back(&expr);
+    while (!pending.empty()) {
+        Work work = std::move(pending.back());
+        pending.pop_back();
+        if (const auto *text = std::get_if<std::string>(&work)) {
+            out += *text;
+        } else if (const auto *expr = std::get_if<const Expr *>(&work)) {
+            std::visit(*this, **expr);
+        } else if (const auto *unary =
+                       std::get_if<const unique_ptr<Unary> *>(&work)) {
+            (*this)(**unary);
+        } else {
+            (*this)(*std::get<const unique_ptr<Primary> *>(work));
+        }
+    }
+    return out;
+}
+
+auto AstPrinter::operator()(const unique_ptr<Binary> &expr) -> void {
+    schedule({"(" + expr->op.lexeme + " ", &expr->left_expr, " ",
+              &expr->right_expr, ")"});
+}
+
+auto AstPrinter::operator()(const unique_ptr<Unary> &expr) -> void {
+    if (const auto *nested = std::get_if<0>(&expr->val)) {
+        schedule({"(" + nested->first.lexeme + " ", &nested->second, ")"});
+        return;
+    }
+    schedule({&std::get<1>(expr->val)});
+}
+
+auto AstPrinter::operator()(const unique_ptr<Primary> &expr) -> void {
+    if (const auto *grouped = std::get_if<Expr>(&expr->val)) {
+        schedule({"(group ", grouped, ")"});
+        return;
+    }
+    pending.emplace_back(std::get<Token>(expr->val).lexeme);
+}
+
+auto AstPrinter::schedule(std::initializer_list<Work> items) -> void {
+    pending.insert(pending.end(), std::rbegin(items), std::rend(items));
+}
@@ -0,0 +1,59 @@
+#include "Expr.h"
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+
+auto push_if_owned(std::vector<Expr> &pending, Expr &&expr) -> void {
+    bool owned =
+        std::visit([](const auto &node) { return node != nullptr; }, expr);
+    if (owned) {
+        pending.push_back(std::move(expr));
+    }
+}
+
+// Moves the direct children of a node onto the worklist, leaving the node
+// with nothing to destroy recursively
+auto release_children(Binary &node, std::vector<Expr> &pending) -> void {
+    push_if_owned(pending, std::move(node.left_expr));
+    push_if_owned(pending, std::move(node.right_expr));
+}
+
+auto release_children(Unary &node, std::vector<Expr> &pending) -> void {
+    if (auto *nested = std::get_if<0>(&node.val)) {
+        push_if_owned(pending, std::move(nested->second));
+    } else {
+        push_if_owned(pending, std::move(std::get<1>(node.val)));
+    }
+}
+
+auto release_children(Primary &node, std::vector<Expr> &pending) -> void {
+    if (auto *grouped = std::get_if<Expr>(&node.val)) {
+        push_if_owned(pending, std::move(*grouped));
+    }
+}
+
+auto teardown(std::vector<Expr> &pending) -> void {
+    while (!pending.empty()) {
+        Expr expr = std::move(pending.back());
+        pending.pop_back();
+        std::visit([&pending](auto &node) { release_children(*node, pending); },
+                   expr);
+        // expr is destroyed here, but its children have already been moved out
+    }
+}
+
+template <typename Node> auto dismantle(Node &node) -> void {
+    std::vector<Expr> pending;
+    release_children(node, pending);
+    teardown(pending);
+}
+
+} // namespace
+
+Primary::~Primary() { dismantle(*this); }
+
+Unary::~Unary() { dismantle(*this); }
+
+Binary::~Binary() { dismantle(*this); }
@@ -0,0 +1,74 @@
+#include "ExprDag.h"
+#include <functional>
+#include <string>
+
+namespace {
+
+auto combine(std::size_t seed, std::size_t value) -> std::size_t {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+} // namespace
+
+auto ExprDag::NodeHash::operator()(NodeId id) const -> std::size_t {
+    const Node &node = (*nodes)[id];
+    std::size_t hash = std::hash<std::string>{}(node.token.lexeme);
+    hash = combine(hash, static_cast<std::size_t>(node.kind));
+    hash = combine(hash, static_cast<std::size_t>(node.token.type));
+    hash = combine(hash, std::hash<NodeId>{}(node.left));
+    return combine(hash, std::hash<NodeId>{}(node.right));
+}
+
+auto ExprDag::NodeEqual::operator()(NodeId a, NodeId b) const -> bool {
+    const Node &first = (*nodes)[a];
+    const Node &second = (*nodes)[b];
+    return first.kind == second.kind &&
+           first.token.type == second.token.type &&
+           first.left == second.left && first.right == second.right &&
+           first.token.lexeme == second.token.lexeme;
+}
+
+// The candidate is stored tentatively so the set can hash it by id, and
+// dropped again if an identical node already exists
+auto ExprDag::intern(Node candidate) -> NodeId {
+    interned_nodes++;
+    auto id = static_cast<NodeId>(nodes.size());
+    nodes.push_back(std::move(candidate));
+    auto [entry, inserted] = ids.insert(id);
+    if (!inserted) {
+        nodes.pop_back();
+    }
+    return *entry;
+}
+
+auto ExprDag::literal(const Token &value) -> NodeId {
+    return intern(Node{Kind::Literal, value});
+}
+
+auto ExprDag::unary(const Token &op, NodeId operand) -> NodeId {
+    return intern(Node{Kind::Unary, op, operand});
+}
+
+auto ExprDag::binary(NodeId left, const Token &op, NodeId right) -> NodeId {
+    return intern(Node{Kind::Binary, op, left, right});
+}
+
+auto ExprDag::print(std::ostream &out) const -> void {
+    for (std::size_t id = 0; id < nodes.size(); id++) {
+        const Node &node = nodes[id];
+        out << "#" << id << " = ";
+        switch (node.kind) {
+        case Kind::Literal:
+            out << node.token.lexeme;
+            break;
+        case Kind::Unary:
+            out << "(" << node.token.lexeme << " #" << node.left << ")";
+            break;
+        case Kind::Binary:
+            out << "(" << node.token.lexeme << " #" << node.left << " #"
+                << node.right << ")";
+            break;
+        }
+        out << "\n";
+    }
+}
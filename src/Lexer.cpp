@@ -1,8 +1,17 @@
 #include "Lexer.h"
-#include "ErrorReporter.h"
+#include "Profiler.h"
 #include "Token.h"
+#include "Unicode.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
 
-std::map<std::string, TokenType> Lexer::string_to_ttype{
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+std::map<std::string, TokenType, std::less<>> Lexer::string_to_ttype{
     {"and", TokenType::AND},       {"class", TokenType::CLASS},
     {"else", TokenType::ELSE},     {"false", TokenType::FALSE},
     {"for", TokenType::FOR},       {"fun", TokenType::FUN},
@@ -12,42 +21,103 @@ std::map<std::string, TokenType> Lexer::string_to_ttype{
     {"this", TokenType::THIS},     {"true", TokenType::TRUE},
     {"var", TokenType::VAR},       {"while", TokenType::WHILE}};
 
-Lexer::Lexer(std::string source) : source(std::move(source)) {}
+namespace {
+
+enum class CharClass : std::uint8_t {
+    Invalid,
+    Whitespace,
+    Newline,
+    Digit,
+    Alpha,
+    Quote,
+    Slash,
+    // Always a one-character token
+    Single,
+    // One-character token, or a two-character one when followed by '='
+    Operator,
+};
+
+struct CharTables {
+    std::array<CharClass, 256> classes{};
+    // Token for Single characters and for Operators not followed by '='
+    std::array<TokenType, 256> single{};
+    // Token for Operators followed by '='
+    std::array<TokenType, 256> with_equal{};
+};
+
+constexpr auto build_char_tables() -> CharTables {
+    CharTables tables{};
+    for (char c = 'a'; c <= 'z'; c++) {
+        tables.classes[static_cast<unsigned char>(c)] = CharClass::Alpha;
+    }
+    for (char c = 'A'; c <= 'Z'; c++) {
+        tables.classes[static_cast<unsigned char>(c)] = CharClass::Alpha;
+    }
+    tables.classes['_'] = CharClass::Alpha;
+    for (char c = '0'; c <= '9'; c++) {
+        tables.classes[static_cast<unsigned char>(c)] = CharClass::Digit;
+    }
+    tables.classes[' '] = CharClass::Whitespace;
+    tables.classes['\r'] = CharClass::Whitespace;
+    tables.classes['\t'] = CharClass::Whitespace;
+    tables.classes['\n'] = CharClass::Newline;
+    tables.classes['"'] = CharClass::Quote;
+    tables.classes['/'] = CharClass::Slash;
+    tables.single['/'] = TokenType::SLASH;
+
+    auto single = [&tables](char c, TokenType type) {
+        tables.classes[static_cast<unsigned char>(c)] = CharClass::Single;
+        tables.single[static_cast<unsigned char>(c)] = type;
+    };
+    single('(', TokenType::LEFT_PAREN);
+    single(')', TokenType::RIGHT_PAREN);
+    single('{', TokenType::LEFT_BRACE);
+    single('}', TokenType::RIGHT_BRACE);
+    single(',', TokenType::COMMA);
+    single('.', TokenType::DOT);
+    single('-', TokenType::MINUS);
+    single('+', TokenType::PLUS);
+    single(';', TokenType::SEMICOLON);
+    single('*', TokenType::STAR);
+
+    auto op = [&tables](char c, TokenType alone, TokenType equal) {
+        tables.classes[static_cast<unsigned char>(c)] = CharClass::Operator;
+        tables.single[static_cast<unsigned char>(c)] = alone;
+        tables.with_equal[static_cast<unsigned char>(c)] = equal;
+    };
+    op('!', TokenType::BANG, TokenType::BANG_EQUAL);
+    op('=', TokenType::EQUAL, TokenType::EQUAL_EQUAL);
+    op('<', TokenType::LESS, TokenType::LESS_EQUAL);
+    op('>', TokenType::GREATER, TokenType::GREATER_EQUAL);
+    return tables;
+}
+
+constexpr CharTables char_tables = build_char_tables();
+
+constexpr auto class_of(char c) -> CharClass {
+    return char_tables.classes[static_cast<unsigned char>(c)];
+}
+
+} // namespace
+
+Lexer::Lexer(std::string source, Diagnostics &diagnostics)
+    : source(std::move(source)), diagnostics(diagnostics) {}
 
 auto Lexer::scan_token() -> void {
     char c = advance();
-    switch (c) {
-    case '(':
-        add_token(TokenType::LEFT_PAREN);
-        break;
-    case ')':
-        add_token(TokenType::RIGHT_PAREN);
-        break;
-    case '{':
-        add_token(TokenType::LEFT_BRACE);
-        break;
-    case '}':
-        add_token(TokenType::RIGHT_BRACE);
-        break;
-    case ',':
-        add_token(TokenType::COMMA);
-        break;
-    case '.':
-        add_token(TokenType::DOT);
+    auto index = static_cast<unsigned char>(c);
+    switch (class_of(c)) {
+    case CharClass::Single:
+        add_token(char_tables.single[index]);
         break;
-    case '-':
-        add_token(TokenType::MINUS);
-        break;
-    case '+':
-        add_token(TokenType::PLUS);
-        break;
-    case ';':
-        add_token(TokenType::SEMICOLON);
-        break;
-    case '*':
-        add_token(TokenType::STAR);
+    case CharClass::Operator:
+        if (match('=')) {
+            add_token(char_tables.with_equal[index]);
+        } else {
+            add_token(char_tables.single[index]);
+        }
         break;
-    case '/': {
+    case CharClass::Slash:
         if (match('/')) {
             handle_comment();
         } else if (match('*')) {
@@ -56,36 +126,27 @@ auto Lexer::scan_token() -> void {
             add_token(TokenType::SLASH);
         }
         break;
-    }
-    case '!':
-        optional_two_char('=', TokenType::BANG, TokenType::BANG_EQUAL);
-        break;
-    case '=':
-        optional_two_char('=', TokenType::EQUAL, TokenType::EQUAL_EQUAL);
-        break;
-    case '<':
-        optional_two_char('=', TokenType::LESS, TokenType::LESS_EQUAL);
+    case CharClass::Quote:
+        handle_string();
         break;
-    case '>':
-        optional_two_char('=', TokenType::GREATER, TokenType::GREATER_EQUAL);
-        break;
-    case '"':
-
-    case ' ':
-    case '\r':
-    case '\t':
+    case CharClass::Whitespace:
         // Ignore whitespace.
         break;
-    case '\n':
+    case CharClass::Newline:
         line++;
+        line_start = current;
         break;
-    default:
-        if (is_digit(c)) {
-            handle_number();
-        } else if (is_alpha(c)) {
-            handle_identifier();
+    case CharClass::Digit:
+        handle_number();
+        break;
+    case CharClass::Alpha:
+        handle_identifier();
+        break;
+    case CharClass::Invalid:
+        if (is_ascii(c)) {
+            syntax_error(start, "Unexpected Character");
         } else {
-            syntax_error(line, "Unexpected Character");
+            handle_non_ascii();
         }
         break;
     }
@@ -102,7 +163,10 @@ auto Lexer::handle_comment_block() -> void {
     while (!is_at_end() && level_nested != 0) {
         char c = peek();
         advance();
-        if (c == '/') {
+        if (c == '\n') {
+            line++;
+            line_start = current;
+        } else if (c == '/') {
             if (match('*')) {
                 level_nested++;
             }
@@ -115,14 +179,26 @@ auto Lexer::handle_comment_block() -> void {
 }
 
 auto Lexer::handle_identifier() -> void {
-    while (is_alpha(peek())) {
-        advance();
+    while (true) {
+        if (is_alpha(peek()) || is_digit(peek())) {
+            advance();
+            continue;
+        }
+        if (is_ascii(peek())) {
+            break;
+        }
+        DecodedCodePoint decoded = decode_utf8(source, current);
+        if (decoded.length == 0 || !is_xid_continue(decoded.code_point)) {
+            break;
+        }
+        current += decoded.length;
     }
-    std::string identifier = source.substr(start, current - start);
+    std::string_view identifier(source.data() + start, current - start);
 
     TokenType type = TokenType::IDENTIFIER;
-    if (string_to_ttype.contains(identifier)) {
-        type = string_to_ttype[identifier];
+    if (auto keyword = string_to_ttype.find(identifier);
+        keyword != string_to_ttype.end()) {
+        type = keyword->second;
     }
 
     add_token(type);
@@ -142,16 +218,50 @@ auto Lexer::handle_number() -> void {
     add_token(TokenType::NUMBER);
 }
 
+// A non-ASCII byte outside a string or comment can only start an identifier
+auto Lexer::handle_non_ascii() -> void {
+    DecodedCodePoint decoded = decode_utf8(source, start);
+    if (decoded.length == 0) {
+        syntax_error(start, "Invalid UTF-8");
+        current = start;
+        skip_invalid_utf8();
+        return;
+    }
+    current = start + decoded.length;
+
+    if (is_xid_start(decoded.code_point)) {
+        handle_identifier();
+    } else {
+        syntax_error(start, "Unexpected Character");
+    }
+}
+
 auto Lexer::handle_string() -> void {
-    while (peek() != '"' && !is_at_end()) {
-        if (peek() == '\n') {
+    while (true) {
+        skip_string_run();
+        char c = peek();
+        if (c == '"' || is_at_end()) {
+            break;
+        }
+        if (c == '\n') {
             line++;
+            advance();
+            line_start = current;
+        } else if (is_ascii(c)) {
+            advance();
+        } else {
+            DecodedCodePoint decoded = decode_utf8(source, current);
+            if (decoded.length == 0) {
+                syntax_error(current, "Invalid UTF-8");
+                skip_invalid_utf8();
+            } else {
+                current += decoded.length;
+            }
         }
-        advance();
     }
 
     if (is_at_end()) {
-        syntax_error(line, "Unterminated String");
+        syntax_error(current, "Unterminated String");
         return;
     }
 
@@ -162,22 +272,14 @@ auto Lexer::handle_string() -> void {
     advance(); // Consume the last '"'
 }
 
-auto Lexer::optional_two_char(const char &optional, TokenType single_type,
-                              TokenType duo_type) -> void {
-    if (match(optional)) {
-        add_token(duo_type);
-    } else {
-        add_token(single_type);
-    }
-}
+// std::string keeps a '\0' at source[source.length()], which acts as a
+// sentinel: reading one past the last character is defined and never matches
+// an expected character, so match() and peek() skip the bounds checks. Any
+// caller peeking further ahead must already know the nearer characters exist.
 
 // Conditionally advances if the char matches
 auto Lexer::match(const char &expected) -> bool {
-    if (is_at_end()) {
-        return false;
-    }
-
-    if (source.at(current) != expected) {
+    if (source[current] != expected) {
         return false;
     }
 
@@ -186,38 +288,104 @@ auto Lexer::match(const char &expected) -> bool {
 }
 
 auto Lexer::peek(int amount_to_peek) -> char {
-    if (current + amount_to_peek >= source.length()) {
-        return '\0';
+    return source[current + amount_to_peek];
+}
+
+// Steps over a malformed sequence's lead byte and any stray continuation
+// bytes after it, so one bad sequence is reported once
+auto Lexer::skip_invalid_utf8() -> void {
+    advance();
+    while ((static_cast<unsigned char>(peek()) & 0xC0) == 0x80) {
+        advance();
+    }
+}
+
+// Skips string contents that need no further attention: ASCII bytes other
+// than the closing quote and newlines. Whole 16-byte blocks are checked at once
+// where SSE2 is available, so only blocks containing a stop byte or a byte with
+// its high bit set fall through to the byte-at-a-time path.
+auto Lexer::skip_string_run() -> void {
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (current + 16 <= static_cast<int>(source.length())) {
+        __m128i block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(source.data() + current));
+        __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                                     _mm_cmpeq_epi8(block, newline));
+        // movemask picks up each byte's high bit, which flags non-ASCII bytes
+        // in the block itself and the matches in stops
+        auto mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_or_si128(stops, block)));
+        if (mask != 0) {
+            current += std::countr_zero(mask);
+            return;
+        }
+        current += 16;
+    }
+#endif
+    while (true) {
+        char c = peek();
+        if (c == '"' || c == '\n' || c == '\0' || !is_ascii(c)) {
+            return;
+        }
+        advance();
     }
-    return source.at(current + amount_to_peek);
 }
 
-auto Lexer::is_digit(char c) -> bool { return c >= '0' && c <= '9'; }
+auto Lexer::is_digit(char c) -> bool { return class_of(c) == CharClass::Digit; }
 
-auto Lexer::is_alpha(char c) -> bool {
-    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+auto Lexer::is_alpha(char c) -> bool { return class_of(c) == CharClass::Alpha; }
+
+auto Lexer::is_ascii(char c) -> bool {
+    return (static_cast<unsigned char>(c) & 0x80) == 0;
 }
 
-auto Lexer::advance() -> char { return source.at(current++); }
+auto Lexer::advance() -> char { return source[current++]; }
 
 auto Lexer::is_at_end() -> bool { return current >= source.length(); }
 
 auto Lexer::add_token(TokenType type) -> void {
-    std::string lexeme = source.substr(start, current - start);
-    tokens.emplace_back(type, lexeme, line);
+    tokens.emplace_back(type, source.substr(start, current - start), line);
 }
 
-auto Lexer::syntax_error(const int line, const std::string &msg) -> void {
-    ErrorReporter &reporter = ErrorReporter::get_instance();
-    reporter.has_error = true;
-    reporter.report_lexer_error(line, msg);
+// Columns count code points from the start of the line, so they line up with
+// what an editor shows for non-ASCII source
+auto Lexer::syntax_error(const int position, const std::string &msg) -> void {
+    int column = count_code_points(source, line_start, position) + 1;
+    diagnostics.report_lexer_error(line, column, msg);
 }
 
 auto Lexer::scan_tokens() -> std::vector<Token> {
+    Profiler::Scope frame("lex", line);
+    Profiler &profiler = Profiler::get_instance();
     while (!is_at_end()) {
+        profiler.set_line(line);
         start = current;
         scan_token();
     }
     tokens.emplace_back(TokenType::EoF, "", line);
-    return tokens;
+    return std::move(tokens);
+}
+
+auto Lexer::next_token() -> std::optional<Token> {
+    Profiler::Scope frame("lex", line);
+    Profiler &profiler = Profiler::get_instance();
+    while (tokens.empty() && !is_at_end()) {
+        profiler.set_line(line);
+        start = current;
+        scan_token();
+    }
+
+    if (tokens.empty()) {
+        if (emitted_eof) {
+            return std::nullopt;
+        }
+        emitted_eof = true;
+        return Token(TokenType::EoF, "", line);
+    }
+
+    Token token = std::move(tokens.back());
+    tokens.pop_back();
+    return token;
 }
@@ -1,98 +1,218 @@
 #include "Parser.h"
-#include "ErrorReporter.h"
 #include "Expr.h"
+#include "Profiler.h"
 #include "Token.h"
 #include <initializer_list>
 #include <memory>
 #include <optional>
+#include <utility>
 
 using std::make_unique;
 
-auto Parser::parse_input() -> std::optional<Expr> {
-    try {
-        return parse_expression();
-    } catch (...) {
-        return std::nullopt;
-    }
-}
+namespace {
+
+// Builders give parse_expression its output. Each literal, group, prefix and
+// infix operator is handed to the builder as soon as its operands are
+// complete.
 
-auto Parser::parse_expression() -> Expr { return parse_equality(); }
+// Builds an owning Expr tree
+struct TreeBuilder {
+    using Operand = Expr;
 
-auto Parser::parse_equality() -> Expr {
-    /*equality → comparison ( ( "!=" | "==" ) comparison )* ;*/
-    Expr expr = parse_comparison();
-    while (match({TokenType::BANG_EQUAL, TokenType::BANG})) {
-        Token op = previous();
-        Expr right = parse_comparison();
-        expr = make_unique<Binary>(std::move(expr), op, std::move(right));
+    static auto literal(const Token &value) -> Expr {
+        return make_unique<Unary>(make_unique<Primary>(value));
     }
-    return expr;
-}
+    static auto group(Expr inner) -> Expr {
+        return make_unique<Unary>(make_unique<Primary>(std::move(inner)));
+    }
+    // Literals, groups and prefixes are all built as Unary, so operand
+    // always holds one
+    static auto prefix(const Token &op, Expr operand) -> Expr {
+        return make_unique<Unary>(std::make_pair(
+            op, std::get<unique_ptr<Unary>>(std::move(operand))));
+    }
+    static auto binary(Expr left, const Token &op, Expr right) -> Expr {
+        return make_unique<Binary>(std::move(left), op, std::move(right));
+    }
+};
+
+// Interns each node into a DAG as it is parsed
+struct DagBuilder {
+    using Operand = ExprDag::NodeId;
+    ExprDag &dag;
 
-auto Parser::parse_comparison() -> Expr {
-    /*comparison → term ( ( ">" | ">=" | "<" | "<=" ) term )* ;*/
-    Expr expr = parse_term();
-    while (match({TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS,
-                  TokenType::LESS_EQUAL})) {
-        Token op = previous();
-        Expr right = parse_term();
-        expr = make_unique<Binary>(std::move(expr), op, std::move(right));
+    auto literal(const Token &value) -> Operand { return dag.literal(value); }
+    static auto group(Operand inner) -> Operand { return inner; }
+    auto prefix(const Token &op, Operand operand) -> Operand {
+        return dag.unary(op, operand);
     }
-    return expr;
-}
+    auto binary(Operand left, const Token &op, Operand right) -> Operand {
+        return dag.binary(left, op, right);
+    }
+};
+
+} // namespace
+
+Parser::Parser(std::vector<Token> tokens, Diagnostics &diagnostics)
+    : next_token([tokens = std::move(tokens),
+                  index = std::size_t{0}]() mutable -> std::optional<Token> {
+          if (index >= tokens.size()) {
+              return std::nullopt;
+          }
+          return std::move(tokens[index++]);
+      }),
+      diagnostics(diagnostics) {}
+
+Parser::Parser(Lexer &lexer, Diagnostics &diagnostics)
+    : next_token([&lexer]() { return lexer.next_token(); }),
+      diagnostics(diagnostics) {}
 
-auto Parser::parse_term() -> Expr {
-    /*term → factor ( ( "-" | "+" ) factor )* ;*/
-    Expr expr = parse_factor();
-    while (match({TokenType::PLUS, TokenType::MINUS})) {
-        Token op = previous();
-        Expr right = parse_factor();
-        expr = make_unique<Binary>(std::move(expr), op, std::move(right));
+auto Parser::parse_input() -> std::optional<Expr> {
+    Profiler::Scope frame("parse", peek().line_num);
+    std::optional<Expr> expr;
+    try {
+        TreeBuilder builder;
+        expr = parse_expression(builder);
+    } catch (...) {
+        // Already reported; the input is still drained below
     }
+    drain_input();
     return expr;
 }
 
-auto Parser::parse_factor() -> Expr {
-    /*factor → unary ( ( "/" | "*" ) unary )* ;*/
-    Expr expr = parse_unary();
-    while (match({TokenType::SLASH, TokenType::STAR})) {
-        Token op = previous();
-        Expr right = parse_unary();
-        expr = make_unique<Binary>(std::move(expr), op, std::move(right));
+auto Parser::parse_input(ExprDag &dag) -> std::optional<ExprDag::NodeId> {
+    Profiler::Scope frame("parse", peek().line_num);
+    std::optional<ExprDag::NodeId> root;
+    try {
+        DagBuilder builder{dag};
+        root = parse_expression(builder);
+    } catch (...) {
+        // Already reported; the input is still drained below
     }
-    return expr;
+    drain_input();
+    return root;
 }
 
-// This function has to return Exprs of the type Unary
-auto Parser::parse_unary() -> Expr {
-    /*unary → ( "!" | "-" ) unary | primary ;*/
-    if (match({TokenType::BANG, TokenType::MINUS})) {
-        Token op = previous();
-        auto unary_expr = std::get<unique_ptr<Unary>>(parse_unary());
-        auto unary = std::make_pair(op, std::move(unary_expr));
-        return make_unique<Unary>(std::move(unary));
+/*
+expression → equality ;
+equality   → comparison ( ( "!=" | "==" ) comparison )* ;
+comparison → term ( ( ">" | ">=" | "<" | "<=" ) term )* ;
+term       → factor ( ( "-" | "+" ) factor )* ;
+factor     → unary ( ( "/" | "*" ) unary )* ;
+unary      → ( "!" | "-" ) unary | primary ;
+primary    → NUMBER | STRING | "true" | "false" | "nil" | "(" expression ")" ;
+
+The grammar is parsed with operator precedence over explicit operand and
+operator stacks rather than one native call per rule, and Expr nodes are freed
+the same way, so nesting depth and chain length are bounded by heap memory
+instead of the call stack.
+*/
+template <typename Builder>
+auto Parser::parse_expression(Builder &builder) -> typename Builder::Operand {
+    std::vector<typename Builder::Operand> operands;
+    std::vector<Frame> frames;
+    int open_groups = 0;
+
+    while (true) {
+        // Operand position: any run of prefix operators and open parens,
+        // followed by a literal
+        while (match({TokenType::BANG, TokenType::MINUS,
+                      TokenType::LEFT_PAREN})) {
+            Token op = previous();
+            if (op.type == TokenType::LEFT_PAREN) {
+                frames.push_back({Frame::Kind::Group, op});
+                open_groups++;
+            } else {
+                frames.push_back({Frame::Kind::Prefix, op});
+            }
+        }
+        if (!match({TokenType::NUMBER, TokenType::STRING, TokenType::TRUE,
+                    TokenType::FALSE, TokenType::NIL})) {
+            throw error(peek(), "Expect expression.");
+        }
+        operands.push_back(
+            close_primary(builder.literal(previous()), frames, builder));
+
+        // Operator position: close whatever groups end here, then either
+        // continue with an infix operator or stop
+        while (open_groups > 0 && check_type(TokenType::RIGHT_PAREN)) {
+            advance();
+            reduce_infix(operands, frames, 1, builder);
+            frames.pop_back(); // The matching Group frame
+            open_groups--;
+
+            typename Builder::Operand inner = std::move(operands.back());
+            operands.pop_back();
+            operands.push_back(close_primary(
+                builder.group(std::move(inner)), frames, builder));
+        }
+
+        int precedence = infix_precedence(peek().type);
+        if (precedence == 0) {
+            break;
+        }
+        reduce_infix(operands, frames, precedence, builder);
+        frames.push_back({Frame::Kind::Infix, advance()});
     }
 
-    auto primary_expr = std::get<unique_ptr<Primary>>(parse_primary());
-    return make_unique<Unary>(std::move(primary_expr));
+    reduce_infix(operands, frames, 1, builder);
+    if (open_groups > 0) {
+        throw error(peek(), "Expected ')' after expression");
+    }
+    return std::move(operands.back());
 }
 
-auto Parser::parse_primary() -> Expr {
-    /*primary → NUMBER | STRING | "true" | "false" | "nil" | "(" expression ")"
-     */
-    Token token = advance();
-    if (match({TokenType::NUMBER, TokenType::STRING, TokenType::TRUE,
-               TokenType::FALSE, TokenType::NIL})) {
-        return make_unique<Primary>(previous());
+// Applies the prefix operators that were waiting on a finished primary,
+// innermost first
+template <typename Builder>
+auto Parser::close_primary(typename Builder::Operand primary,
+                           std::vector<Frame> &frames, Builder &builder) ->
+    typename Builder::Operand {
+    while (!frames.empty() && frames.back().kind == Frame::Kind::Prefix) {
+        primary = builder.prefix(frames.back().op, std::move(primary));
+        frames.pop_back();
     }
+    return primary;
+}
 
-    if (match({TokenType::LEFT_PAREN})) {
-        Expr expr = parse_expression();
-        consume(TokenType::RIGHT_PAREN, "Expected ')' after expression");
-        return expr;
+// Folds pending infix operators that bind at least as tightly as
+// min_precedence, which keeps every level left associative
+template <typename Builder>
+auto Parser::reduce_infix(std::vector<typename Builder::Operand> &operands,
+                          std::vector<Frame> &frames, int min_precedence,
+                          Builder &builder) -> void {
+    while (!frames.empty() && frames.back().kind == Frame::Kind::Infix &&
+           infix_precedence(frames.back().op.type) >= min_precedence) {
+        typename Builder::Operand right = std::move(operands.back());
+        operands.pop_back();
+        typename Builder::Operand left = std::move(operands.back());
+        operands.pop_back();
+        operands.push_back(builder.binary(std::move(left), frames.back().op,
+                                          std::move(right)));
+        frames.pop_back();
     }
+}
 
-    throw error(peek(), "Expect expression.");
+// Binding strength of each binary operator, 0 if the token isn't one
+auto Parser::infix_precedence(TokenType type) -> int {
+    switch (type) {
+    case TokenType::BANG_EQUAL:
+    case TokenType::EQUAL_EQUAL:
+        return 1;
+    case TokenType::GREATER:
+    case TokenType::GREATER_EQUAL:
+    case TokenType::LESS:
+    case TokenType::LESS_EQUAL:
+        return 2;
+    case TokenType::MINUS:
+    case TokenType::PLUS:
+        return 3;
+    case TokenType::SLASH:
+    case TokenType::STAR:
+        return 4;
+    default:
+        return 0;
+    }
 }
 
 /* Error Handling */
@@ -104,9 +224,7 @@ auto Parser::consume(TokenType type, const std::string &msg) -> Token {
 }
 
 auto Parser::error(Token token, const std::string &msg) -> ParseError {
-    ErrorReporter &reporter = ErrorReporter::get_instance();
-    reporter.has_error = true;
-    reporter.report_parser_error(token, msg);
+    diagnostics.report_parser_error(token, msg);
     return ParseError();
 }
 
@@ -153,7 +271,7 @@ auto Parser::peek() -> Token {
     if (is_at_end()) {
         return Token::create_eof();
     }
-    return tokens.at(current);
+    return window[current % window_size].value();
 }
 
 auto Parser::check_type(TokenType type) -> bool { return peek().type == type; }
@@ -163,9 +281,38 @@ auto Parser::advance() -> Token {
         return Token::create_eof();
     }
     current++;
-    return previous();
+    Token token = previous();
+    Profiler::get_instance().set_line(token.line_num);
+    return token;
+}
+
+auto Parser::is_at_end() -> bool {
+    fill_window();
+    return current >= filled;
+}
+
+auto Parser::previous() -> Token {
+    return window[(current - 1) % window_size].value();
 }
 
-auto Parser::is_at_end() -> bool { return current >= tokens.size(); }
+// Pulls the current token into the window if it hasn't been read yet
+auto Parser::fill_window() -> void {
+    if (current < filled || source_exhausted) {
+        return;
+    }
+    std::optional<Token> token = next_token();
+    if (!token.has_value()) {
+        source_exhausted = true;
+        return;
+    }
+    window[filled % window_size] = std::move(token);
+    filled++;
+}
 
-auto Parser::previous() -> Token { return tokens.at(current - 1); }
+// Discards the tokens after the parsed expression one at a time, so a
+// streaming lexer still scans, and reports errors in, the whole input
+auto Parser::drain_input() -> void {
+    while (!source_exhausted) {
+        source_exhausted = !next_token().has_value();
+    }
+}
@@ -0,0 +1,153 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <sys/time.h>
+
+auto Profiler::get_instance() -> Profiler & {
+    static Profiler instance; // Guaranteed to be initialized once
+    return instance;
+}
+
+thread_local std::array<Profiler::Frame, Profiler::max_depth> Profiler::stack{};
+thread_local volatile std::sig_atomic_t Profiler::depth = 0;
+
+Profiler::Scope::Scope(const char *name, int line) {
+    Profiler::get_instance().push(name, line);
+}
+
+Profiler::Scope::~Scope() { Profiler::get_instance().pop(); }
+
+auto Profiler::push(const char *name, int line) -> void {
+    // Frames past max_depth are still counted so pops stay balanced, but only
+    // the outermost max_depth are recorded
+    if (depth < max_depth) {
+        stack[depth] = Frame{name, line};
+    }
+    // The handler may run between these two stores, so the frame has to be
+    // written before it becomes visible through depth
+    std::atomic_signal_fence(std::memory_order_release);
+    depth = depth + 1;
+}
+
+auto Profiler::pop() -> void { depth = depth - 1; }
+
+auto Profiler::reset(std::size_t max_samples) -> void {
+    // Reserve everything up front; the handler must not allocate
+    samples.assign(max_samples, Sample{});
+    frame_names.assign(max_samples * reserved_depth, nullptr);
+    sample_count = 0;
+    frame_count = 0;
+    dropped = 0;
+}
+
+auto Profiler::start(int interval_us, int expected_seconds) -> void {
+    if (interval_us <= 0 || expected_seconds <= 0) {
+        throw std::runtime_error(
+            "Profiler interval and duration must be positive");
+    }
+    reset(static_cast<std::size_t>(expected_seconds) * 1000000 / interval_us);
+
+    struct sigaction action {};
+    action.sa_handler = on_signal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, nullptr) != 0) {
+        throw std::runtime_error(
+            std::string("Unable to install profiler signal handler: ") +
+            std::strerror(errno));
+    }
+
+    // tv_usec must stay below one second, so longer intervals carry over
+    itimerval timer{};
+    timer.it_interval.tv_sec = interval_us / 1000000;
+    timer.it_interval.tv_usec = interval_us % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        throw std::runtime_error(
+            std::string("Unable to start profiler timer: ") +
+            std::strerror(errno));
+    }
+    running = true;
+}
+
+auto Profiler::stop() -> void {
+    if (!running) {
+        return;
+    }
+    itimerval timer{};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    std::signal(SIGPROF, SIG_IGN);
+    running = false;
+}
+
+auto Profiler::on_signal(int /*signal*/) -> void {
+    get_instance().record_sample();
+}
+
+auto Profiler::record_sample() -> void {
+    int sample_depth = std::min(static_cast<int>(depth), max_depth);
+    if (sample_count >= static_cast<int>(samples.size()) ||
+        frame_count + sample_depth > static_cast<int>(frame_names.size())) {
+        dropped = dropped + 1;
+        return;
+    }
+
+    Sample &sample = samples[sample_count];
+    sample.first = frame_count;
+    sample.depth = sample_depth;
+    sample.line = sample_depth > 0 ? stack[sample_depth - 1].line : 0;
+    for (int i = 0; i < sample_depth; i++) {
+        frame_names[frame_count + i] = stack[i].name;
+    }
+    frame_count = frame_count + sample_depth;
+    sample_count = sample_count + 1;
+}
+
+auto Profiler::write_folded(std::ostream &os) const -> void {
+    std::map<std::string, int> stacks;
+    for (int i = 0; i < sample_count; i++) {
+        const Sample &sample = samples[i];
+        std::string folded = "jlox";
+        for (int j = 0; j < sample.depth; j++) {
+            folded += ";";
+            folded += frame_names[sample.first + j];
+        }
+        if (sample.depth > 0) {
+            folded += ";line " + std::to_string(sample.line);
+        }
+        stacks[folded]++;
+    }
+    for (const auto &[folded, count] : stacks) {
+        os << folded << " " << count << "\n";
+    }
+}
+
+auto Profiler::print_line_summary(std::ostream &os) const -> void {
+    // Each sample is attributed to the line of its innermost frame
+    std::map<int, int> line_hits;
+    int attributed = 0;
+    for (int i = 0; i < sample_count; i++) {
+        const Sample &sample = samples[i];
+        if (sample.depth > 0) {
+            line_hits[sample.line]++;
+            attributed++;
+        }
+    }
+    std::vector<std::pair<int, int>> by_hits(line_hits.begin(),
+                                             line_hits.end());
+    std::stable_sort(by_hits.begin(), by_hits.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.second > b.second;
+                     });
+
+    os << "Samples: " << sample_count << " (" << dropped << " dropped)\n";
+    for (const auto &[line, hits] : by_hits) {
+        os << "[Line " << line << "] " << hits << " hits ("
+           << 100 * hits / attributed << "%)\n";
+    }
+}
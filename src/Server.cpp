@@ -0,0 +1,470 @@
+#include "Server.h"
+#include <arpa/inet.h>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <poll.h>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t prefix_size = sizeof(std::uint32_t);
+
+auto system_error(const std::string &what) -> std::runtime_error {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+// Closes the descriptor when it goes out of scope
+class Socket {
+  public:
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+    Socket(const Socket &) = delete;
+    Socket &operator=(const Socket &) = delete;
+    Socket(Socket &&other) noexcept : fd(std::exchange(other.fd, -1)) {}
+    Socket &operator=(Socket &&other) noexcept {
+        std::swap(fd, other.fd);
+        return *this;
+    }
+
+    int fd;
+};
+
+auto make_address(const std::filesystem::path &socket_path) -> sockaddr_un {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string &path = socket_path.native();
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long");
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+auto connect_to(const sockaddr_un &address) -> std::optional<Socket> {
+    Socket socket_fd(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (socket_fd.fd < 0 ||
+        connect(socket_fd.fd, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) < 0) {
+        return std::nullopt;
+    }
+    return socket_fd;
+}
+
+// Returns false if the peer closed the connection before all bytes arrived
+auto read_exact(int fd, void *buffer, std::size_t size) -> bool {
+    auto *bytes = static_cast<char *>(buffer);
+    while (size > 0) {
+        ssize_t received = recv(fd, bytes, size, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+auto write_all(int fd, const void *buffer, std::size_t size) -> bool {
+    const auto *bytes = static_cast<const char *>(buffer);
+    while (size > 0) {
+        // MSG_NOSIGNAL so a client hanging up doesn't kill the server
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// The payload length announced by a prefix, or nullopt if it is too large.
+// Checked before any payload is read, so a bogus prefix can't ask for 4GB.
+// The server still only buffers a request's bytes as they arrive, since a
+// valid prefix alone shouldn't reserve max_message_size.
+auto decode_length(const char *prefix) -> std::optional<std::uint32_t> {
+    std::uint32_t length = 0;
+    std::memcpy(&length, prefix, prefix_size);
+    length = ntohl(length);
+    if (length > max_message_size) {
+        return std::nullopt;
+    }
+    return length;
+}
+
+// A connection whose request is still arriving. The acceptor reads these
+// without blocking, so a client that stalls only holds its own entry.
+struct PendingRequest {
+    Socket client;
+    std::string received; // Length prefix included
+    Clock::time_point deadline;
+};
+
+enum class ReadState { Waiting, Complete, Failed };
+
+// Takes whatever has arrived on the connection. Fails the request once it
+// holds more than allowance bytes.
+auto receive_available(PendingRequest &request, std::size_t allowance)
+    -> ReadState {
+    std::array<char, 16 * 1024> chunk{};
+    while (true) {
+        ssize_t received = recv(request.client.fd, chunk.data(), chunk.size(),
+                                MSG_DONTWAIT);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return ReadState::Waiting;
+        }
+        if (received <= 0) {
+            return ReadState::Failed;
+        }
+        request.received.append(chunk.data(), received);
+
+        if (request.received.size() >= prefix_size) {
+            std::optional<std::uint32_t> length =
+                decode_length(request.received.data());
+            if (!length.has_value()) {
+                return ReadState::Failed;
+            }
+            std::size_t total = prefix_size + length.value();
+            // Anything past the first request is ignored, as the connection
+            // closes after the reply
+            if (request.received.size() >= total) {
+                request.received.resize(total);
+                return ReadState::Complete;
+            }
+        }
+        if (request.received.size() > allowance) {
+            return ReadState::Failed;
+        }
+    }
+}
+
+// Bounds every send and recv on fd, so a client that stops reading its reply
+// fails the call with EAGAIN instead of holding a worker forever
+auto set_timeouts(int fd, std::chrono::milliseconds timeout) -> void {
+    auto micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(timeout).count();
+    timeval value{};
+    value.tv_sec = static_cast<time_t>(micros / 1000000);
+    value.tv_usec = static_cast<suseconds_t>(micros % 1000000);
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &value, sizeof(value));
+}
+
+// Runs a script into its own output buffer, so nothing leaks between sessions
+auto run_session(const std::string &source, const ScriptRunner &run_script)
+    -> Response {
+    std::stringstream output;
+    bool succeeded = false;
+    try {
+        succeeded = run_script(source, output);
+    } catch (const std::exception &e) {
+        output << "Error: " << e.what() << "\n";
+    }
+    return {succeeded ? Status::Ok : Status::Error, output.str()};
+}
+
+// A complete request waiting for a worker
+struct Job {
+    Socket client;
+    std::string source;
+};
+
+// Worker threads answering complete requests in arrival order. The
+// destructor stops taking work and joins the workers once the queue drains.
+class WorkerPool {
+  public:
+    WorkerPool(unsigned worker_count, const ScriptRunner &run_script,
+               std::chrono::milliseconds io_timeout) {
+        workers.reserve(worker_count);
+        for (unsigned i = 0; i < worker_count; i++) {
+            workers.emplace_back([this, &run_script, io_timeout]() {
+                while (std::optional<Job> job = take()) {
+                    answer(job.value(), run_script, io_timeout);
+                }
+            });
+        }
+    }
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        ready.notify_all();
+        // std::jthread joins as workers is destroyed
+    }
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    auto submit(Job job) -> void {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push(std::move(job));
+        }
+        ready.notify_one();
+    }
+
+  private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::queue<Job> pending;
+    bool closed = false;
+    // Declared last so the workers stop before the queue they read is gone
+    std::vector<std::jthread> workers;
+
+    // Blocks until a job is queued; nullopt once the pool is closed and
+    // drained
+    auto take() -> std::optional<Job> {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready.wait(lock, [this]() { return closed || !pending.empty(); });
+        if (pending.empty()) {
+            return std::nullopt;
+        }
+        Job job = std::move(pending.front());
+        pending.pop();
+        return job;
+    }
+
+    static auto answer(const Job &job, const ScriptRunner &run_script,
+                       std::chrono::milliseconds io_timeout) -> void {
+        Response response = run_session(job.source, run_script);
+        set_timeouts(job.client.fd, io_timeout);
+        auto status_byte = static_cast<std::uint8_t>(response.status);
+        if (write_all(job.client.fd, &status_byte, sizeof(status_byte))) {
+            write_payload(job.client.fd, response.output);
+        }
+    }
+};
+
+// Only a socket left behind by an earlier server may be removed. Anything
+// else at the path is somebody's file, and a socket that still accepts
+// connections belongs to a running server.
+auto remove_stale_socket(const sockaddr_un &address) -> void {
+    struct stat info {};
+    if (lstat(address.sun_path, &info) < 0) {
+        if (errno == ENOENT) {
+            return;
+        }
+        throw system_error("Unable to inspect socket path");
+    }
+    if (!S_ISSOCK(info.st_mode)) {
+        throw std::runtime_error(std::string("Refusing to replace ") +
+                                 address.sun_path + ": not a socket");
+    }
+    if (connect_to(address).has_value()) {
+        throw std::runtime_error(
+            std::string("A server is already running on ") +
+            address.sun_path);
+    }
+    if (unlink(address.sun_path) < 0) {
+        throw system_error("Unable to remove stale socket");
+    }
+}
+
+// How long poll may sleep: until the earliest pending deadline, and no more
+// than a tenth of a second when serve can be stopped, so a stop is noticed
+auto poll_timeout(const std::vector<PendingRequest> &pending,
+                  const std::stop_token &stop) -> int {
+    int timeout = -1;
+    if (!pending.empty()) {
+        Clock::time_point earliest = pending.front().deadline;
+        for (const PendingRequest &request : pending) {
+            earliest = std::min(earliest, request.deadline);
+        }
+        auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+            earliest - Clock::now());
+        timeout = static_cast<int>(std::max<long long>(0, remaining.count()));
+    }
+    if (stop.stop_possible()) {
+        timeout = timeout < 0 ? 100 : std::min(timeout, 100);
+    }
+    return timeout;
+}
+
+} // namespace
+
+auto read_payload(int fd) -> std::optional<std::string> {
+    std::array<char, prefix_size> prefix{};
+    if (!read_exact(fd, prefix.data(), prefix.size())) {
+        return std::nullopt;
+    }
+    std::optional<std::uint32_t> length = decode_length(prefix.data());
+    if (!length.has_value()) {
+        return std::nullopt;
+    }
+    std::string payload(length.value(), '\0');
+    if (!read_exact(fd, payload.data(), payload.size())) {
+        return std::nullopt;
+    }
+    return payload;
+}
+
+auto write_payload(int fd, const std::string &payload) -> bool {
+    std::uint32_t length = htonl(static_cast<std::uint32_t>(payload.size()));
+    return write_all(fd, &length, sizeof(length)) &&
+           write_all(fd, payload.data(), payload.size());
+}
+
+auto serve(const std::filesystem::path &socket_path,
+           const ScriptRunner &run_script, const ServeOptions &options)
+    -> void {
+    Socket listener(socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.fd < 0) {
+        throw system_error("Unable to create socket");
+    }
+    // Non-blocking, so a client that hangs up between poll and accept can't
+    // stall the loop
+    fcntl(listener.fd, F_SETFL, fcntl(listener.fd, F_GETFL) | O_NONBLOCK);
+
+    sockaddr_un address = make_address(socket_path);
+    remove_stale_socket(address);
+    if (bind(listener.fd, reinterpret_cast<sockaddr *>(&address),
+             sizeof(address)) < 0) {
+        throw system_error("Unable to bind socket");
+    }
+    if (listen(listener.fd, SOMAXCONN) < 0) {
+        throw system_error("Unable to listen on socket");
+    }
+
+    WorkerPool pool(std::max(1U, options.worker_count), run_script,
+                    options.io_timeout);
+    std::vector<PendingRequest> pending;
+    // Bytes held across all of pending
+    std::size_t buffered = 0;
+    std::vector<pollfd> polled;
+    while (!options.stop.stop_requested()) {
+        // While pending is full, new connections wait in the listen backlog
+        short accepting = pending.size() < options.max_pending ? POLLIN : 0;
+        polled.assign(1, pollfd{listener.fd, accepting, 0});
+        for (const PendingRequest &request : pending) {
+            polled.push_back(pollfd{request.client.fd, POLLIN, 0});
+        }
+        if (poll(polled.data(), polled.size(),
+                 poll_timeout(pending, options.stop)) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw system_error("Unable to poll connections");
+        }
+
+        Clock::time_point now = Clock::now();
+        // Backwards, so finished entries can be swapped out of the vector
+        for (std::size_t i = pending.size(); i-- > 0;) {
+            PendingRequest &request = pending[i];
+            ReadState state = ReadState::Waiting;
+            std::size_t others = buffered - request.received.size();
+            if (polled[i + 1].revents != 0) {
+                // buffered never exceeds the cap, so this can't underflow
+                state = receive_available(request,
+                                          options.max_buffered_bytes - others);
+                request.deadline = now + options.io_timeout;
+            } else if (now >= request.deadline) {
+                state = ReadState::Failed;
+            }
+            if (state == ReadState::Waiting) {
+                buffered = others + request.received.size();
+                continue;
+            }
+            buffered = others;
+            if (state == ReadState::Complete) {
+                pool.submit(Job{std::move(request.client),
+                                request.received.substr(prefix_size)});
+            }
+            // Failed connections are closed as their entry is dropped
+            request = std::move(pending.back());
+            pending.pop_back();
+        }
+
+        if ((polled[0].revents & POLLIN) == 0) {
+            continue;
+        }
+        while (pending.size() < options.max_pending) {
+            int client_fd = accept(listener.fd, nullptr, nullptr);
+            if (client_fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                throw system_error("Unable to accept connection");
+            }
+            pending.push_back(
+                {Socket(client_fd), "", now + options.io_timeout});
+        }
+    }
+    unlink(address.sun_path);
+}
+
+auto send_request(const std::filesystem::path &socket_path,
+                  const std::string &source) -> std::optional<Response> {
+    std::optional<Socket> server = connect_to(make_address(socket_path));
+    if (!server.has_value()) {
+        throw system_error("Unable to connect to server");
+    }
+    std::uint8_t status_byte = 0;
+    if (!write_payload(server->fd, source) ||
+        !read_exact(server->fd, &status_byte, sizeof(status_byte))) {
+        return std::nullopt;
+    }
+    std::optional<std::string> output = read_payload(server->fd);
+    if (!output.has_value()) {
+        return std::nullopt;
+    }
+    return Response{static_cast<Status>(status_byte), output.value()};
+}
+
+auto run_client(const std::filesystem::path &socket_path,
+                const std::filesystem::path &script_path) -> int {
+    std::ifstream file(script_path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open provided file");
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string source = buffer.str();
+
+    auto sent_at = Clock::now();
+    std::optional<Response> response = send_request(socket_path, source);
+    auto received_at = Clock::now();
+    if (!response.has_value()) {
+        throw std::runtime_error("Server closed the connection");
+    }
+
+    std::cout << response->output;
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        received_at - sent_at);
+    std::cerr << "Round trip: " << latency.count() << "us\n";
+    return response->status == Status::Ok ? 0 : 1;
+}
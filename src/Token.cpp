@@ -1,4 +1,5 @@
 #include "Token.h"
+#include <unordered_map>
 
 // Custom hash function for TokenType (needed for unordered_map)
 struct TokenTypeHash {
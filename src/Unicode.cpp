@@ -0,0 +1,81 @@
+#include "Unicode.h"
+#include "UnicodeTables.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+template <std::size_t N>
+auto in_ranges(const std::array<CodePointRange, N> &ranges,
+               char32_t code_point) -> bool {
+    auto range = std::upper_bound(ranges.begin(), ranges.end(), code_point,
+                                  [](char32_t value, const CodePointRange &r) {
+                                      return value < r.first;
+                                  });
+    if (range == ranges.begin()) {
+        return false;
+    }
+    return code_point <= std::prev(range)->last;
+}
+
+auto is_continuation(unsigned char byte) -> bool {
+    return (byte & 0xC0) == 0x80;
+}
+
+} // namespace
+
+auto decode_utf8(const std::string &text, int position) -> DecodedCodePoint {
+    const DecodedCodePoint invalid{0, 0};
+    auto lead = static_cast<unsigned char>(text[position]);
+
+    int length = 0;
+    char32_t code_point = 0;
+    char32_t min_value = 0;
+    if (lead < 0x80) {
+        return {lead, 1};
+    }
+    if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+        code_point = lead & 0x1F;
+        min_value = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+        code_point = lead & 0x0F;
+        min_value = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+        code_point = lead & 0x07;
+        min_value = 0x10000;
+    } else {
+        return invalid;
+    }
+
+    for (int i = 1; i < length; i++) {
+        auto byte = static_cast<unsigned char>(text[position + i]);
+        if (!is_continuation(byte)) {
+            return invalid;
+        }
+        code_point = (code_point << 6) | (byte & 0x3F);
+    }
+
+    if (code_point < min_value || code_point > 0x10FFFF ||
+        (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return invalid;
+    }
+    return {code_point, length};
+}
+
+auto is_xid_start(char32_t code_point) -> bool {
+    return in_ranges(xid_start_ranges, code_point);
+}
+
+auto is_xid_continue(char32_t code_point) -> bool {
+    return in_ranges(xid_continue_ranges, code_point);
+}
+
+auto count_code_points(const std::string &text, int from, int to) -> int {
+    return static_cast<int>(
+        std::count_if(text.begin() + from, text.begin() + to, [](char c) {
+            return !is_continuation(static_cast<unsigned char>(c));
+        }));
+}
@@ -1,7 +1,10 @@
-#include "ErrorReporter.h"
+#include "Diagnostics.h"
+#include "ExprDag.h"
 #include "ExprVisitor.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "Profiler.h"
+#include "Server.h"
 
 #include <filesystem>
 #include <fstream>
@@ -10,21 +13,40 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
+
+// What a run prints: the expression tree, or with --dag the nodes of a
+// hash-consed ExprDag
+enum class Output { Tree, Dag };
+
+// Writes the result and any diagnostics to out and returns whether the script
+// ran without errors
+auto run(const std::string &source, std::ostream &out, Output output) -> bool {
+    Diagnostics diagnostics(out);
+    Lexer lexer(source, diagnostics);
+    Parser parser = Parser(lexer, diagnostics);
+
+    if (output == Output::Dag) {
+        ExprDag dag;
+        parser.parse_input(dag);
+        if (diagnostics.has_error()) {
+            return false;
+        }
+        dag.print(out);
+        return true;
+    }
 
-auto run(const std::string &source) -> void {
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.scan_tokens();
-    Parser parser = Parser(tokens);
     std::optional<Expr> parser_result = parser.parse_input();
 
-    if (ErrorReporter::get_instance().has_error) {
-        return;
+    if (diagnostics.has_error()) {
+        return false;
     }
 
-    std::cout << AstPrinter().print(parser_result.value());
+    out << AstPrinter().print(parser_result.value()) << "\n";
+    return true;
 }
 
-auto run_file(const std::filesystem::path &path) -> void {
+auto run_file(const std::filesystem::path &path, Output output) -> bool {
     std::ifstream file(path);
     if (!file.is_open()) {
         throw std::runtime_error("Unable to open provided file");
@@ -34,35 +56,81 @@ auto run_file(const std::filesystem::path &path) -> void {
     buffer << file.rdbuf();
     std::string source = buffer.str();
 
-    run(source);
-
-    if (ErrorReporter::get_instance().has_error) {
-        exit(1);
-    }
+    return run(source, std::cout, output);
 }
 
-auto run_prompt() -> void {
+auto run_prompt(Output output) -> void {
     std::string line;
     std::cout << ">";
     while (std::getline(std::cin, line)) {
-        run(line);
+        run(line, std::cout, output);
         std::cout << ">";
-        ErrorReporter::get_instance().has_error = false;
     }
 }
 
+auto write_profile(const std::filesystem::path &path) -> void {
+    Profiler &profiler = Profiler::get_instance();
+    profiler.stop();
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open provided profile output");
+    }
+    profiler.write_folded(file);
+    profiler.print_line_summary(std::cout);
+}
+
 auto main(int argc, char *argv[]) -> int {
+    // Note: argc counts the program itself (i.e. "./jlox") as an argument
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    // Server and client modes keep stdout for script output only
+    if (args.size() == 2 && args.front() == "--serve") {
+        serve(args[1], [](const std::string &source, std::ostream &out) {
+            return run(source, out, Output::Tree);
+        });
+        return 0;
+    }
+    if (args.size() == 3 && args.front() == "--client") {
+        return run_client(args[1], args[2]);
+    }
+
     std::cout << argv[0] << "\n";
+    // Flags may come in any order; whatever isn't one is the script
+    const std::string profile_flag = "--profile=";
+    std::optional<std::filesystem::path> profile_path;
+    Output output = Output::Tree;
+    std::vector<std::string> scripts;
+    for (const std::string &arg : args) {
+        if (arg.starts_with(profile_flag)) {
+            profile_path = arg.substr(profile_flag.size());
+        } else if (arg == "--dag") {
+            output = Output::Dag;
+        } else {
+            scripts.push_back(arg);
+        }
+    }
 
-    // Note: argc counts the program itself (i.e. "./jlox") as an argument
-    if (argc > 2) {
-        throw std::runtime_error("Expected Usage: ./jlox [script]");
+    if (scripts.size() > 1) {
+        throw std::runtime_error(
+            "Expected Usage: ./jlox [--profile=out.folded] [--dag] "
+            "[script] | --serve <socket> | --client <socket> <script>");
     }
-    if (argc == 2) {
+    if (profile_path) {
+        Profiler::get_instance().start();
+    }
+    bool succeeded = true;
+    if (scripts.size() == 1) {
         // run jlox from the provided file
-    } else if (argc == 1) {
+        succeeded = run_file(scripts.front(), output);
+    } else {
         // run jlox as repl
-        run_prompt();
+        run_prompt(output);
+    }
+    // Written even when the script failed, since that's often when the
+    // profile is wanted
+    if (profile_path) {
+        write_profile(profile_path.value());
     }
-    return 0;
+    return succeeded ? 0 : 1;
 }
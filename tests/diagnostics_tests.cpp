@@ -0,0 +1,87 @@
+#include "Diagnostics.h"
+#include "Lexer.h"
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(DiagnosticsTests, ConcurrentReportsStayWholeAndSeparate) {
+    const int thread_count = 8;
+    const int reports_per_thread = 500;
+    std::stringstream shared_output;
+    std::mutex output_mutex;
+    std::vector<Diagnostics> diagnostics(
+        thread_count, Diagnostics(shared_output, output_mutex));
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++) {
+        threads.emplace_back([&diagnostics, i] {
+            for (int j = 0; j < reports_per_thread; j++) {
+                diagnostics[i].report_lexer_error(i + 1, j + 1,
+                                                  "a reasonably long message");
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    for (const Diagnostics &run : diagnostics) {
+        EXPECT_EQ(run.count(), reports_per_thread);
+    }
+    std::string line;
+    int lines = 0;
+    while (std::getline(shared_output, line)) {
+        EXPECT_TRUE(line.starts_with("Syntax Error [Line ")) << line;
+        EXPECT_TRUE(line.ends_with("]: a reasonably long message")) << line;
+        lines++;
+    }
+    EXPECT_EQ(lines, thread_count * reports_per_thread);
+}
+
+TEST(DiagnosticsTests, FailingRunDoesNotTaintConcurrentRun) {
+    std::stringstream failing_output;
+    std::stringstream clean_output;
+    Diagnostics failing(failing_output);
+    Diagnostics clean(clean_output);
+
+    std::thread bad([&failing] {
+        for (int i = 0; i < 100; i++) {
+            Lexer("var @ = 1;", failing).scan_tokens();
+        }
+    });
+    std::thread good([&clean] {
+        for (int i = 0; i < 100; i++) {
+            Lexer("var x = 1;", clean).scan_tokens();
+        }
+    });
+    bad.join();
+    good.join();
+
+    EXPECT_EQ(failing.count(), 100);
+    EXPECT_FALSE(clean.has_error());
+}
+
+TEST(DiagnosticsTests, PrivateStreamTakesNoSharedLock) {
+    std::stringstream output;
+    Diagnostics diagnostics(output);
+    std::mutex *stdout_mutex =
+        ErrorReporter::get_instance().mutex_for(std::cout);
+    ASSERT_NE(stdout_mutex, nullptr);
+
+    // Declared before the lock, so the lock is released before the future
+    // waits for the report
+    std::future<void> report;
+    std::lock_guard<std::mutex> held(*stdout_mutex);
+    report = std::async(std::launch::async, [&diagnostics] {
+        diagnostics.report_lexer_error(1, 1, "unexpected");
+    });
+    ASSERT_EQ(report.wait_for(std::chrono::seconds(5)),
+              std::future_status::ready);
+    EXPECT_EQ(output.str(), "Syntax Error [Line 1, Column 1]: unexpected\n");
+}
@@ -0,0 +1,87 @@
+#include "Diagnostics.h"
+#include "ExprDag.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <sstream>
+#include <string>
+
+namespace {
+
+auto parse(ExprDag &dag, const std::string &source) -> ExprDag::NodeId {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer lexer(source, diagnostics);
+    std::optional<ExprDag::NodeId> root =
+        Parser(lexer, diagnostics).parse_input(dag);
+    EXPECT_TRUE(root.has_value());
+    return root.value_or(-1);
+}
+
+} // namespace
+
+TEST(ExprDagTests, RepeatedSubexpressionsShareNodes) {
+    ExprDag dag;
+    ExprDag::NodeId root = parse(dag, "(1 + 2) * (1 + 2)");
+
+    const ExprDag::Node &product = dag.node(root);
+    EXPECT_EQ(product.kind, ExprDag::Kind::Binary);
+    EXPECT_EQ(product.token.type, TokenType::STAR);
+    EXPECT_EQ(product.left, product.right);
+    // 1, 2, 1 + 2 and the product
+    EXPECT_EQ(dag.size(), 4U);
+    EXPECT_EQ(dag.tree_size(), 7U);
+}
+
+TEST(ExprDagTests, DifferentOperatorsStayDistinct) {
+    ExprDag dag;
+    ExprDag::NodeId root = parse(dag, "-1 - !1");
+
+    const ExprDag::Node &difference = dag.node(root);
+    EXPECT_NE(difference.left, difference.right);
+    EXPECT_EQ(dag.node(difference.left).left,
+              dag.node(difference.right).left);
+}
+
+TEST(ExprDagTests, SharingSpansParses) {
+    ExprDag dag;
+    ExprDag::NodeId first = parse(dag, "true == \"x\"");
+    ExprDag::NodeId second = parse(dag, "\"x\"");
+    EXPECT_EQ(dag.node(first).right, second);
+}
+
+TEST(ExprDagTests, DeepNestingDoesNotRecurse) {
+    std::string source;
+    const int depth = 100000;
+    for (int i = 0; i < depth; i++) {
+        source += "-(";
+    }
+    source += "1";
+    source.append(depth, ')');
+
+    ExprDag dag;
+    parse(dag, source);
+    EXPECT_EQ(dag.size(), depth + 1U);
+}
+
+TEST(ExprDagTests, ParseErrorsLeaveNoRoot) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer lexer("(1 + 2", diagnostics);
+    ExprDag dag;
+    EXPECT_FALSE(Parser(lexer, diagnostics).parse_input(dag).has_value());
+    EXPECT_TRUE(diagnostics.has_error());
+}
+
+TEST(ExprDagTests, PrintListsEachNodeOnce) {
+    ExprDag dag;
+    parse(dag, "-(1 + 2) * (1 + 2)");
+    std::stringstream out;
+    dag.print(out);
+    EXPECT_EQ(out.str(), "#0 = 1\n"
+                         "#1 = 2\n"
+                         "#2 = (+ #0 #1)\n"
+                         "#3 = (- #2)\n"
+                         "#4 = (* #3 #2)\n");
+}
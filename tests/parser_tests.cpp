@@ -0,0 +1,174 @@
+#include "Diagnostics.h"
+#include "ExprVisitor.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct ParseResult {
+    std::optional<Expr> expr;
+    std::string errors;
+};
+
+auto parse(const std::string &source) -> ParseResult {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer lexer(source, diagnostics);
+    std::optional<Expr> expr = Parser(lexer, diagnostics).parse_input();
+    return {std::move(expr), errors.str()};
+}
+
+auto print(const std::string &source) -> std::string {
+    ParseResult result = parse(source);
+    EXPECT_TRUE(result.expr.has_value()) << result.errors;
+    if (!result.expr.has_value()) {
+        return "";
+    }
+    return AstPrinter().print(result.expr.value());
+}
+
+} // namespace
+
+TEST(ParserTests, Precedence) {
+    EXPECT_EQ(print("1 + 2 * 3"), "(+ 1 (* 2 3))");
+    EXPECT_EQ(print("1 * 2 + 3"), "(+ (* 1 2) 3)");
+    EXPECT_EQ(print("1 < 2 + 3 == true"), "(== (< 1 (+ 2 3)) true)");
+    EXPECT_EQ(print("-1 * -2"), "(* (- 1) (- 2))");
+}
+
+TEST(ParserTests, LeftAssociativity) {
+    EXPECT_EQ(print("1 - 2 - 3"), "(- (- 1 2) 3)");
+    EXPECT_EQ(print("8 / 4 / 2"), "(/ (/ 8 4) 2)");
+    EXPECT_EQ(print("1 == 2 != 3"), "(!= (== 1 2) 3)");
+}
+
+TEST(ParserTests, GroupsUnderPrefixOperators) {
+    EXPECT_EQ(print("-(1 + 2)"), "(- (group (+ 1 2)))");
+    EXPECT_EQ(print("!!(nil)"), "(! (! (group nil)))");
+    EXPECT_EQ(print("((1)) * 2"), "(* (group (group 1)) 2)");
+}
+
+TEST(ParserTests, MissingOperand) {
+    ParseResult result = parse("1 +");
+    EXPECT_FALSE(result.expr.has_value());
+    EXPECT_EQ(result.errors, "[line 1] Error at end: Expect expression.\n");
+}
+
+TEST(ParserTests, UnclosedGroup) {
+    ParseResult result = parse("(1 + 2");
+    EXPECT_FALSE(result.expr.has_value());
+    EXPECT_EQ(result.errors,
+              "[line 1] Error at end: Expected ')' after expression\n");
+}
+
+TEST(ParserTests, DeepNestingParsesAndFrees) {
+    const int depth = 100000;
+    std::string source;
+    for (int i = 0; i < depth; i++) {
+        source += "-(";
+    }
+    source += "1";
+    source.append(depth, ')');
+
+    ParseResult result = parse(source);
+    ASSERT_TRUE(result.expr.has_value());
+    // Destroying result here must not recurse once per level
+}
+
+TEST(ParserTests, LongChainParsesAndFrees) {
+    // Far past what recursive destructors survive on a default 8MB stack
+    std::string source = "1";
+    for (int i = 0; i < 200000; i++) {
+        source += " + 1";
+    }
+    ParseResult result = parse(source);
+    ASSERT_TRUE(result.expr.has_value());
+}
+
+namespace {
+
+// Parses source both from a scanned token vector and by streaming from the
+// lexer, returning the printed AST (or "<none>") followed by any errors
+auto parse_both_ways(const std::string &source)
+    -> std::pair<std::string, std::string> {
+    auto describe = [](std::optional<Expr> expr, const std::string &errors) {
+        std::string printed =
+            expr.has_value() ? AstPrinter().print(expr.value()) : "<none>";
+        return printed + "|" + errors;
+    };
+
+    std::stringstream batch_errors;
+    Diagnostics batch_diagnostics(batch_errors);
+    std::vector<Token> tokens =
+        Lexer(source, batch_diagnostics).scan_tokens();
+    std::optional<Expr> batch =
+        Parser(std::move(tokens), batch_diagnostics).parse_input();
+
+    std::stringstream stream_errors;
+    Diagnostics stream_diagnostics(stream_errors);
+    Lexer lexer(source, stream_diagnostics);
+    std::optional<Expr> streamed =
+        Parser(lexer, stream_diagnostics).parse_input();
+
+    return {describe(std::move(batch), batch_errors.str()),
+            describe(std::move(streamed), stream_errors.str())};
+}
+
+} // namespace
+
+TEST(ParserTests, StreamingMatchesBatch) {
+    for (const std::string source :
+         {"1 + 2 * (3 - -4) == !5", "\"a\" != \"b\"", "((1))", "1 2", "1 )",
+          "(1 + 2", "1 +", "", "-", "1\n+\n(2\n*\n3)"}) {
+        auto [batch, streamed] = parse_both_ways(source);
+        EXPECT_EQ(batch, streamed) << source;
+    }
+}
+
+TEST(ParserTests, StreamingReportsEndOfInput) {
+    auto [batch, streamed] = parse_both_ways("(1 +\n2");
+    EXPECT_EQ(streamed,
+              "<none>|[line 2] Error at end: Expected ')' after expression\n");
+}
+
+TEST(ParserTests, TokenVectorWithoutEoF) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    std::vector<Token> tokens{{TokenType::NUMBER, "1", 1},
+                              {TokenType::PLUS, "+", 1}};
+    std::optional<Expr> expr =
+        Parser(std::move(tokens), diagnostics).parse_input();
+    EXPECT_FALSE(expr.has_value());
+    EXPECT_EQ(errors.str(), "[line 0] Error at end: Expect expression.\n");
+}
+
+TEST(ParserTests, LexerErrorsAfterTheExpressionAreReported) {
+    ParseResult trailing = parse("1 2 @");
+    EXPECT_EQ(trailing.errors,
+              "Syntax Error [Line 1, Column 5]: Unexpected Character\n");
+
+    ParseResult non_ascii = parse("1 \u20ac");
+    EXPECT_EQ(non_ascii.errors,
+              "Syntax Error [Line 1, Column 3]: Unexpected Character\n");
+
+    // Parse errors come first, then what the lexer finds further on
+    ParseResult both = parse("a\u20ac");
+    EXPECT_EQ(both.errors, "[line 1] Error at : Expect expression.\n"
+                           "Syntax Error [Line 1, Column 2]: Unexpected "
+                           "Character\n");
+}
+
+TEST(ParserTests, DagParseReportsTrailingLexerErrors) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer lexer("1 + 1 @", diagnostics);
+    ExprDag dag;
+    EXPECT_TRUE(Parser(lexer, diagnostics).parse_input(dag).has_value());
+    EXPECT_TRUE(diagnostics.has_error());
+}
@@ -0,0 +1,94 @@
+#include "Profiler.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/time.h>
+
+namespace {
+
+// Records four samples at known points: three while parsing, one while lexing
+auto record_known_samples(Profiler &profiler) -> void {
+    profiler.reset(16);
+    {
+        Profiler::Scope parse("parse", 1);
+        profiler.set_line(3);
+        profiler.record_sample();
+        profiler.record_sample();
+        profiler.set_line(7);
+        profiler.record_sample();
+    }
+    {
+        Profiler::Scope lex("lex", 1);
+        profiler.record_sample();
+    }
+}
+
+} // namespace
+
+TEST(ProfilerTests, FoldedOutputKeepsLinesAsLeafFrames) {
+    Profiler &profiler = Profiler::get_instance();
+    record_known_samples(profiler);
+
+    std::stringstream folded;
+    profiler.write_folded(folded);
+    EXPECT_EQ(folded.str(), "jlox;lex;line 1 1\n"
+                            "jlox;parse;line 3 2\n"
+                            "jlox;parse;line 7 1\n");
+}
+
+TEST(ProfilerTests, NestedFramesFoldInOrder) {
+    Profiler &profiler = Profiler::get_instance();
+    profiler.reset(4);
+    {
+        Profiler::Scope parse("parse", 1);
+        Profiler::Scope lex("lex", 2);
+        profiler.record_sample();
+    }
+    profiler.record_sample();
+
+    std::stringstream folded;
+    profiler.write_folded(folded);
+    EXPECT_EQ(folded.str(), "jlox 1\njlox;parse;lex;line 2 1\n");
+}
+
+TEST(ProfilerTests, LineSummaryOrdersByHits) {
+    Profiler &profiler = Profiler::get_instance();
+    record_known_samples(profiler);
+
+    std::stringstream summary;
+    profiler.print_line_summary(summary);
+    EXPECT_EQ(summary.str(), "Samples: 4 (0 dropped)\n"
+                             "[Line 3] 2 hits (50%)\n"
+                             "[Line 1] 1 hits (25%)\n"
+                             "[Line 7] 1 hits (25%)\n");
+}
+
+TEST(ProfilerTests, FullBufferDropsSamples) {
+    Profiler &profiler = Profiler::get_instance();
+    profiler.reset(1);
+    Profiler::Scope parse("parse", 1);
+    profiler.record_sample();
+    profiler.record_sample();
+
+    std::stringstream summary;
+    profiler.print_line_summary(summary);
+    EXPECT_EQ(summary.str(),
+              "Samples: 1 (1 dropped)\n[Line 1] 1 hits (100%)\n");
+}
+
+TEST(ProfilerTests, StartRejectsNonPositiveArguments) {
+    Profiler &profiler = Profiler::get_instance();
+    EXPECT_THROW(profiler.start(0), std::runtime_error);
+    EXPECT_THROW(profiler.start(-1000), std::runtime_error);
+    EXPECT_THROW(profiler.start(1000, 0), std::runtime_error);
+}
+
+TEST(ProfilerTests, StartArmsIntervalsOfASecondOrMore) {
+    Profiler &profiler = Profiler::get_instance();
+    profiler.start(1500000, 1);
+    itimerval timer{};
+    getitimer(ITIMER_PROF, &timer);
+    profiler.stop();
+    EXPECT_EQ(timer.it_interval.tv_sec, 1);
+    EXPECT_EQ(timer.it_interval.tv_usec, 500000);
+}
@@ -0,0 +1,147 @@
+#include "Diagnostics.h"
+#include "Lexer.h"
+#include "Token.h"
+#include <gtest/gtest.h>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+auto scan(const std::string &source) -> std::vector<Token> {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    return Lexer(source, diagnostics).scan_tokens();
+}
+
+auto scan_types(const std::string &source) -> std::vector<TokenType> {
+    std::vector<TokenType> types;
+    for (const Token &token : scan(source)) {
+        types.push_back(token.type);
+    }
+    return types;
+}
+
+} // namespace
+
+TEST(ScannerTests, OneAndTwoCharacterOperators) {
+    EXPECT_EQ(scan_types("! != = == < <= > >= / * - +"),
+              (std::vector<TokenType>{
+                  TokenType::BANG, TokenType::BANG_EQUAL, TokenType::EQUAL,
+                  TokenType::EQUAL_EQUAL, TokenType::LESS,
+                  TokenType::LESS_EQUAL, TokenType::GREATER,
+                  TokenType::GREATER_EQUAL, TokenType::SLASH, TokenType::STAR,
+                  TokenType::MINUS, TokenType::PLUS, TokenType::EoF}));
+}
+
+TEST(ScannerTests, OperatorAtEndOfSource) {
+    EXPECT_EQ(scan_types("a <"),
+              (std::vector<TokenType>{TokenType::IDENTIFIER, TokenType::LESS,
+                                      TokenType::EoF}));
+}
+
+TEST(ScannerTests, CommentsAreSkipped) {
+    std::vector<Token> tokens = scan("1 // line\n/* outer /* inner */ */ 2");
+    ASSERT_EQ(tokens.size(), 3U);
+    EXPECT_EQ(tokens[0].lexeme, "1");
+    EXPECT_EQ(tokens[1].lexeme, "2");
+    EXPECT_EQ(tokens[1].line_num, 2);
+}
+
+TEST(ScannerTests, NumbersAndKeywords) {
+    std::vector<Token> tokens = scan("var x = 12.5 and 3.");
+    std::vector<TokenType> types;
+    for (const Token &token : tokens) {
+        types.push_back(token.type);
+    }
+    EXPECT_EQ(types, (std::vector<TokenType>{
+                         TokenType::VAR, TokenType::IDENTIFIER,
+                         TokenType::EQUAL, TokenType::NUMBER, TokenType::AND,
+                         TokenType::NUMBER, TokenType::DOT, TokenType::EoF}));
+    EXPECT_EQ(tokens[3].lexeme, "12.5");
+}
+
+TEST(ScannerTests, NextTokenMatchesScanTokens) {
+    const std::string source = "if (a >= 1) { print b; } // done\nc";
+    std::vector<Token> scanned = scan(source);
+
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer lexer(source, diagnostics);
+    for (const Token &expected : scanned) {
+        std::optional<Token> token = lexer.next_token();
+        ASSERT_TRUE(token.has_value());
+        EXPECT_EQ(token->type, expected.type);
+        EXPECT_EQ(token->lexeme, expected.lexeme);
+        EXPECT_EQ(token->line_num, expected.line_num);
+    }
+    EXPECT_FALSE(lexer.next_token().has_value());
+}
+
+TEST(ScannerTests, StringLiterals) {
+    std::vector<Token> tokens = scan("\"hello\" \"two\nlines\"");
+    ASSERT_EQ(tokens.size(), 3U);
+    EXPECT_EQ(tokens[0].type, TokenType::STRING);
+    EXPECT_EQ(tokens[0].lexeme, "hello");
+    EXPECT_EQ(tokens[1].lexeme, "two\nlines");
+    EXPECT_EQ(tokens[1].line_num, 2);
+}
+
+TEST(ScannerTests, Utf8IdentifiersAndStrings) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    std::vector<Token> tokens =
+        Lexer("var привет = \"héllo wörld, long enough for a block\"; 名前",
+              diagnostics)
+            .scan_tokens();
+    ASSERT_EQ(tokens.size(), 7U);
+    EXPECT_EQ(tokens[1].type, TokenType::IDENTIFIER);
+    EXPECT_EQ(tokens[1].lexeme, "привет");
+    EXPECT_EQ(tokens[3].type, TokenType::STRING);
+    EXPECT_EQ(tokens[3].lexeme, "héllo wörld, long enough for a block");
+    EXPECT_EQ(tokens[5].lexeme, "名前");
+    EXPECT_FALSE(diagnostics.has_error());
+}
+
+TEST(ScannerTests, InvalidUtf8IsReported) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    Lexer("a \xC3( \"\xE2\x82\"", diagnostics).scan_tokens();
+    EXPECT_EQ(diagnostics.count(), 2);
+    EXPECT_EQ(errors.str(), "Syntax Error [Line 1, Column 3]: Invalid UTF-8\n"
+                            "Syntax Error [Line 1, Column 7]: Invalid UTF-8\n");
+}
+
+TEST(ScannerTests, NonIdentifierCodePointIsUnexpected) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    std::vector<TokenType> types;
+    for (const Token &token : Lexer("a € b", diagnostics).scan_tokens()) {
+        types.push_back(token.type);
+    }
+    EXPECT_EQ(types, (std::vector<TokenType>{TokenType::IDENTIFIER,
+                                             TokenType::IDENTIFIER,
+                                             TokenType::EoF}));
+    EXPECT_TRUE(diagnostics.has_error());
+}
+
+TEST(ScannerTests, IdentifiersContinueWithDigits) {
+    std::vector<Token> tokens = scan("a1 x_2y a١");
+    ASSERT_EQ(tokens.size(), 4U);
+    EXPECT_EQ(tokens[0].type, TokenType::IDENTIFIER);
+    EXPECT_EQ(tokens[0].lexeme, "a1");
+    EXPECT_EQ(tokens[1].lexeme, "x_2y");
+    EXPECT_EQ(tokens[2].lexeme, "a١");
+}
+
+TEST(ScannerTests, BlockCommentsAdvanceLines) {
+    std::stringstream errors;
+    Diagnostics diagnostics(errors);
+    std::vector<Token> tokens =
+        Lexer("/*\nxx\n*/ # 1", diagnostics).scan_tokens();
+    EXPECT_EQ(errors.str(),
+              "Syntax Error [Line 3, Column 4]: Unexpected Character\n");
+    ASSERT_EQ(tokens.size(), 2U);
+    EXPECT_EQ(tokens[0].line_num, 3);
+}
@@ -0,0 +1,308 @@
+#include "Diagnostics.h"
+#include "ExprVisitor.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "Server.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Parses one expression and prints it, the way jlox's own runner does
+auto print_expression(const std::string &source, std::ostream &out) -> bool {
+    Diagnostics diagnostics(out);
+    Lexer lexer(source, diagnostics);
+    std::optional<Expr> expr = Parser(lexer, diagnostics).parse_input();
+    if (diagnostics.has_error()) {
+        return false;
+    }
+    out << AstPrinter().print(expr.value());
+    return true;
+}
+
+auto socket_path() -> std::filesystem::path {
+    return std::filesystem::temp_directory_path() /
+           ("jlox_server_tests_" + std::to_string(getpid()) + ".sock");
+}
+
+// A raw client connection, for sending requests the client helpers won't
+class Connection {
+  public:
+    explicit Connection(const std::filesystem::path &path)
+        : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.native().copy(address.sun_path, sizeof(address.sun_path) - 1);
+        connected = connect(fd, reinterpret_cast<sockaddr *>(&address),
+                            sizeof(address)) == 0;
+    }
+    ~Connection() { close(fd); }
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    // Whether the server closed the connection within timeout, having sent
+    // nothing
+    auto closed_within(std::chrono::milliseconds timeout) const -> bool {
+        timeval value{0, static_cast<suseconds_t>(timeout.count() * 1000)};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+        char byte = 0;
+        return recv(fd, &byte, 1, 0) == 0;
+    }
+
+    // Whether a reply's status byte arrives within timeout
+    auto answered_within(std::chrono::milliseconds timeout) const -> bool {
+        timeval value{0, static_cast<suseconds_t>(timeout.count() * 1000)};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &value, sizeof(value));
+        std::uint8_t status = 0;
+        return recv(fd, &status, 1, 0) == 1;
+    }
+
+    const int fd;
+    bool connected = false;
+};
+
+// Runs serve on a thread until the test ends
+class TestServer {
+  public:
+    explicit TestServer(ServeOptions options = {},
+                        ScriptRunner run_script = print_expression)
+        : path(socket_path()), run_script(std::move(run_script)),
+          thread([this, options](std::stop_token stop) mutable {
+              options.stop = std::move(stop);
+              serve(path, this->run_script, options);
+          }) {
+        for (int i = 0; i < 200 && !Connection(path).connected; i++) {
+            std::this_thread::sleep_for(10ms);
+        }
+    }
+
+    const std::filesystem::path path;
+
+  private:
+    ScriptRunner run_script;
+    std::jthread thread;
+};
+
+auto write_length(int fd, std::uint32_t length) -> void {
+    std::uint32_t prefix = htonl(length);
+    ASSERT_EQ(send(fd, &prefix, sizeof(prefix), 0),
+              static_cast<ssize_t>(sizeof(prefix)));
+}
+
+} // namespace
+
+TEST(ServerTests, PayloadsRoundTrip) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    const std::string binary("a\0b\n\xff", 5);
+    ASSERT_TRUE(write_payload(fds[0], binary));
+    ASSERT_TRUE(write_payload(fds[0], ""));
+    EXPECT_EQ(read_payload(fds[1]), binary);
+    EXPECT_EQ(read_payload(fds[1]), "");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(ServerTests, TruncatedPayloadIsRejected) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    write_length(fds[0], 10);
+    ASSERT_EQ(send(fds[0], "abc", 3, 0), 3);
+    close(fds[0]);
+    EXPECT_EQ(read_payload(fds[1]), std::nullopt);
+    close(fds[1]);
+}
+
+TEST(ServerTests, AnswersRequests) {
+    TestServer server;
+    std::optional<Response> ok = send_request(server.path, "1 + 2 * 3");
+    ASSERT_TRUE(ok.has_value());
+    EXPECT_EQ(ok->status, Status::Ok);
+    EXPECT_EQ(ok->output, "(+ 1 (* 2 3))");
+
+    std::optional<Response> failed = send_request(server.path, "(1 +");
+    ASSERT_TRUE(failed.has_value());
+    EXPECT_EQ(failed->status, Status::Error);
+    EXPECT_EQ(failed->output, "[line 1] Error at end: Expect expression.\n");
+}
+
+TEST(ServerTests, OversizedLengthIsRejectedWithoutWaiting) {
+    ServeOptions options;
+    options.io_timeout = 10s;
+    TestServer server(options);
+    Connection client(server.path);
+    write_length(client.fd, max_message_size + 1);
+    // Only the size check can end this before the ten second timeout
+    EXPECT_TRUE(client.closed_within(1s));
+}
+
+TEST(ServerTests, StalledClientIsDroppedWithoutBlockingOthers) {
+    ServeOptions options;
+    options.worker_count = 1;
+    options.io_timeout = 300ms;
+    TestServer server(options);
+    Connection stalled(server.path);
+    // Half of a length prefix, then nothing
+    ASSERT_EQ(send(stalled.fd, "\0\0", 2, 0), 2);
+
+    auto started = std::chrono::steady_clock::now();
+    std::optional<Response> response = send_request(server.path, "1");
+    EXPECT_LT(std::chrono::steady_clock::now() - started, 200ms);
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->output, "1");
+
+    EXPECT_TRUE(stalled.closed_within(2s));
+}
+
+TEST(ServerTests, RequestPastTheBufferCapIsDropped) {
+    ServeOptions options;
+    options.io_timeout = 10s;
+    options.max_buffered_bytes = 1024;
+    TestServer server(options);
+    Connection client(server.path);
+    // A valid length reserves nothing; the bytes that follow hit the cap
+    write_length(client.fd, 4096);
+    const std::string partial(2000, '1');
+    ASSERT_EQ(send(client.fd, partial.data(), partial.size(), 0),
+              static_cast<ssize_t>(partial.size()));
+    EXPECT_TRUE(client.closed_within(1s));
+
+    std::optional<Response> response = send_request(server.path, "1");
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->output, "1");
+}
+
+TEST(ServerTests, ConnectionsPastThePendingCapWait) {
+    ServeOptions options;
+    options.io_timeout = 10s;
+    options.max_pending = 1;
+    TestServer server(options);
+    auto stalled = std::make_unique<Connection>(server.path);
+    ASSERT_EQ(send(stalled->fd, "\0\0", 2, 0), 2);
+
+    Connection waiting(server.path);
+    ASSERT_TRUE(write_payload(waiting.fd, "1"));
+    // Left in the listen backlog while the stalled client fills pending
+    EXPECT_FALSE(waiting.answered_within(300ms));
+
+    stalled.reset();
+    ASSERT_TRUE(waiting.answered_within(1s));
+    EXPECT_EQ(read_payload(waiting.fd), "1");
+}
+
+TEST(ServerTests, ConnectionEndsAfterOneRequest) {
+    TestServer server;
+    Connection client(server.path);
+    ASSERT_TRUE(write_payload(client.fd, "1"));
+    ASSERT_TRUE(write_payload(client.fd, "2"));
+
+    std::uint8_t status = 1;
+    ASSERT_EQ(recv(client.fd, &status, 1, MSG_WAITALL), 1);
+    EXPECT_EQ(status, 0);
+    EXPECT_EQ(read_payload(client.fd), "1");
+    // The second request is never answered
+    EXPECT_TRUE(client.closed_within(1s));
+}
+
+TEST(ServerTests, RunnerExceptionsBecomeErrors) {
+    TestServer server({}, [](const std::string &, std::ostream &) -> bool {
+        throw std::runtime_error("boom");
+    });
+    std::optional<Response> response = send_request(server.path, "1");
+    ASSERT_TRUE(response.has_value());
+    EXPECT_EQ(response->status, Status::Error);
+    EXPECT_EQ(response->output, "Error: boom\n");
+}
+
+TEST(ServerTests, ConcurrentSessionsAreIsolated) {
+    ServeOptions options;
+    options.worker_count = 4;
+    TestServer server(options);
+    const int thread_count = 8;
+    const int requests_per_thread = 50;
+    std::atomic<int> mismatches = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++) {
+        threads.emplace_back([i, &server, &mismatches] {
+            // Odd threads send broken scripts; their errors must not reach
+            // the even threads' sessions
+            bool broken = i % 2 == 1;
+            Response expected =
+                broken ? Response{Status::Error,
+                                  "[line 1] Error at end: Expect "
+                                  "expression.\n"}
+                       : Response{Status::Ok, "(+ 1 2)"};
+            for (int j = 0; j < requests_per_thread; j++) {
+                std::optional<Response> response =
+                    send_request(server.path, broken ? "(1 +" : "1 + 2");
+                if (!response.has_value() ||
+                    response->status != expected.status ||
+                    response->output != expected.output) {
+                    mismatches++;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(mismatches, 0);
+}
+
+TEST(ServerTests, ServeRefusesToReplaceAFile) {
+    std::filesystem::path path = socket_path();
+    std::ofstream(path) << "precious data";
+
+    EXPECT_THROW(serve(path, print_expression), std::runtime_error);
+
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    EXPECT_EQ(contents.str(), "precious data");
+    std::filesystem::remove(path);
+}
+
+TEST(ServerTests, ServeRefusesALiveServersSocket) {
+    TestServer server;
+    EXPECT_THROW(serve(server.path, print_expression), std::runtime_error);
+    EXPECT_TRUE(send_request(server.path, "1").has_value());
+}
+
+TEST(ServerTests, StaleSocketIsReplacedAndRemovedOnStop) {
+    std::filesystem::path path = socket_path();
+    {
+        // Bound and closed without unlinking, as a crashed server leaves it
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.native().copy(address.sun_path, sizeof(address.sun_path) - 1);
+        ASSERT_EQ(bind(fd, reinterpret_cast<sockaddr *>(&address),
+                       sizeof(address)),
+                  0);
+        close(fd);
+    }
+    {
+        TestServer server;
+        EXPECT_TRUE(send_request(path, "1").has_value());
+    }
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
@@ -0,0 +1,53 @@
+import unicodedata
+
+# str.isidentifier() classifies code points with XID_Start / XID_Continue
+# (PEP 3131), so Python's own Unicode database is the source of the tables
+
+
+def is_xid_start(cp: int) -> bool:
+    return chr(cp).isidentifier()
+
+
+def is_xid_continue(cp: int) -> bool:
+    return ("a" + chr(cp)).isidentifier()
+
+
+def collect_ranges(predicate) -> list[tuple[int, int]]:
+    ranges = []
+    # ASCII is classified by the lexer's own character table
+    for cp in range(0x80, 0x110000):
+        if not predicate(cp):
+            continue
+        if ranges and ranges[-1][1] == cp - 1:
+            ranges[-1] = (ranges[-1][0], cp)
+        else:
+            ranges.append((cp, cp))
+    return ranges
+
+
+def write_ln(file, text=""):
+    file.write(text + "\n")
+
+
+def write_table(f, name: str, ranges: list[tuple[int, int]]):
+    write_ln(f, f"constexpr std::array<CodePointRange, {len(ranges)}> {name}{{{{")
+    for lo, hi in ranges:
+        write_ln(f, f"    {{0x{lo:X}, 0x{hi:X}}},")
+    write_ln(f, "}};")
+
+
+def write_file(filename: str):
+    with open(filename, "w") as f:
+        write_ln(f, "// Generated by unicode_generator.py from Unicode "
+                 + unicodedata.unidata_version + ", do not edit by hand")
+        write_ln(f, "#pragma once")
+        write_ln(f, '#include "Unicode.h"')
+        write_ln(f, "#include <array>")
+        write_ln(f)
+        write_table(f, "xid_start_ranges", collect_ranges(is_xid_start))
+        write_ln(f)
+        write_table(f, "xid_continue_ranges", collect_ranges(is_xid_continue))
+
+
+if __name__ == "__main__":
+    write_file("include/UnicodeTables.h")